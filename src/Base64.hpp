@@ -0,0 +1,107 @@
+/*
+ * Base64.hpp - Chunked base64 encoding and streaming decoding for ESP8266/ESP32.
+ *
+ * Audio travels through JSON as base64. The encoder works on whatever block the caller has (a multiple of 3
+ * bytes continues seamlessly in the next call), so a recording is encoded piece by piece on its way to the
+ * socket. The decoder takes characters one at a time, as StreamJsonParser hands them out, and passes the
+ * bytes on in blocks of N, so a long clip never has to fit in memory.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+class Base64 {
+public:
+  static size_t encodedLength(size_t length) {
+    return (length + 2) / 3 * 4;
+  }
+
+  // Writes encodedLength(length) characters to `out` (no terminator) and returns that number.
+  static size_t encode(const uint8_t* data, size_t length, char* out) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char* start = out;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+      uint32_t group = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+      *out++ = alphabet[group >> 18];
+      *out++ = alphabet[(group >> 12) & 0x3F];
+      *out++ = alphabet[(group >> 6) & 0x3F];
+      *out++ = alphabet[group & 0x3F];
+    }
+    if (i < length) {
+      uint32_t group = (uint32_t)data[i] << 16 | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0);
+      *out++ = alphabet[group >> 18];
+      *out++ = alphabet[(group >> 12) & 0x3F];
+      *out++ = i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=';
+      *out++ = '=';
+    }
+    return out - start;
+  }
+
+  // 0-63 for a base64 character (standard or URL-safe alphabet), -1 for anything else.
+  static int8_t value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+  }
+};
+
+// Decodes characters pushed one at a time and hands the bytes to `onData` in blocks of up to N. Padding,
+// whitespace and invalid characters are skipped.
+template <size_t N>
+class Base64Decoder {
+public:
+  explicit Base64Decoder(std::function<void(const uint8_t*, size_t)> onData) : _onData(onData) {}
+
+  void push(char c) {
+    int8_t value = Base64::value(c);
+    if (value < 0) {
+      return;
+    }
+    _bits = _bits << 6 | (uint8_t)value;
+    _count += 6;
+    if (_count >= 8) {
+      _count -= 8;
+      _block[_length++] = (uint8_t)(_bits >> _count);
+      if (_length == N) {
+        _flush();
+      }
+    }
+  }
+
+  // Hands out what is left of the block.
+  void finish() {
+    _flush();
+    _bits = 0;
+    _count = 0;
+  }
+
+  size_t decoded() const {
+    return _decoded;
+  }
+
+private:
+  std::function<void(const uint8_t*, size_t)> _onData;
+  uint8_t _block[N];
+  size_t _length = 0;
+  size_t _decoded = 0;
+  uint32_t _bits = 0;
+  uint8_t _count = 0;
+
+  void _flush() {
+    if (_length > 0) {
+      _onData(_block, _length);
+      _decoded += _length;
+      _length = 0;
+    }
+  }
+};
@@ -0,0 +1,121 @@
+/*
+ * BatchAnswerDemux.hpp - A push-based demultiplexer for batched Gemini answers.
+ *
+ * Batch requests ask the model for a JSON array with one string per question (structured output).
+ * The answer text arrives as a stream of characters; this state machine splits it back into the
+ * individual array elements on the fly, unescaping each string and handing every character to a
+ * per-item callback as soon as it is parsed. Nothing is buffered, so the first answer can be shown
+ * while the later ones are still being generated.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+class BatchAnswerDemux {
+public:
+  BatchAnswerDemux(std::function<void(size_t, char)> onChar, std::function<void(size_t)> onItemEnd = nullptr)
+    : _onChar(onChar), _onItemEnd(onItemEnd), _state(BEFORE_ARRAY), _index(0),
+      _codepoint(0), _highSurrogate(0), _hexDigits(0) {}
+
+  void push(char c) {
+    switch (_state) {
+      case BEFORE_ARRAY:
+        if (c == '[') _state = BETWEEN;
+        break;
+      case BETWEEN:
+        if (c == '"') _state = IN_STRING;
+        else if (c == ']') _state = DONE;
+        break;
+      case IN_STRING:
+        if (c == '"') {
+          if (_onItemEnd) _onItemEnd(_index);
+          _index++;
+          _state = BETWEEN;
+        } else if (c == '\\') {
+          _state = ESCAPE;
+        } else {
+          _onChar(_index, c);
+        }
+        break;
+      case ESCAPE:
+        _state = IN_STRING;
+        switch (c) {
+          case 'b': _onChar(_index, '\b'); break;
+          case 'f': _onChar(_index, '\f'); break;
+          case 'n': _onChar(_index, '\n'); break;
+          case 'r': _onChar(_index, '\r'); break;
+          case 't': _onChar(_index, '\t'); break;
+          case 'u':
+            _codepoint = 0;
+            _hexDigits = 0;
+            _state = UNICODE;
+            break;
+          default: _onChar(_index, c); break;
+        }
+        break;
+      case UNICODE:
+        _codepoint = (_codepoint << 4) | _hexValue(c);
+        if (++_hexDigits == 4) {
+          _state = IN_STRING;
+          _emitCodepoint(_codepoint);
+        }
+        break;
+      case DONE:
+        break;
+    }
+  }
+
+  size_t completed() const { return _index; }
+  bool done() const { return _state == DONE; }
+
+private:
+  enum State : uint8_t { BEFORE_ARRAY, BETWEEN, IN_STRING, ESCAPE, UNICODE, DONE };
+
+  std::function<void(size_t, char)> _onChar;
+  std::function<void(size_t)> _onItemEnd;
+  State _state;
+  size_t _index;
+  uint16_t _codepoint;
+  uint16_t _highSurrogate;
+  uint8_t _hexDigits;
+
+  static uint8_t _hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+  }
+
+  void _emitCodepoint(uint16_t cp) {
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+      _highSurrogate = cp;
+      return;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF && _highSurrogate) {
+      uint32_t full = 0x10000 + ((uint32_t)(_highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+      _highSurrogate = 0;
+      _onChar(_index, (char)(0xF0 | ((full >> 18) & 0x07)));
+      _onChar(_index, (char)(0x80 | ((full >> 12) & 0x3F)));
+      _onChar(_index, (char)(0x80 | ((full >> 6) & 0x3F)));
+      _onChar(_index, (char)(0x80 | (full & 0x3F)));
+      return;
+    }
+    _highSurrogate = 0;
+    if (cp < 0x80) {
+      _onChar(_index, (char)cp);
+    } else if (cp < 0x800) {
+      _onChar(_index, (char)(0xC0 | (cp >> 6)));
+      _onChar(_index, (char)(0x80 | (cp & 0x3F)));
+    } else {
+      _onChar(_index, (char)(0xE0 | (cp >> 12)));
+      _onChar(_index, (char)(0x80 | ((cp >> 6) & 0x3F)));
+      _onChar(_index, (char)(0x80 | (cp & 0x3F)));
+    }
+  }
+};
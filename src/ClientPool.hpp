@@ -0,0 +1,289 @@
+/*
+ * ClientPool.hpp - A small pool of persistent Gemini connections for parallel requests from several FreeRTOS
+ * tasks (ESP32).
+ *
+ * Every slot owns a kept-alive client and its own request arena, so requests on different slots share nothing.
+ * A slot is taken with a single compare-and-swap on a bitmask of busy slots and given back with a single
+ * atomic AND; no lock is held while a request runs, and a task only waits (polling) when every slot is busy.
+ * Checkout prefers slots whose connection is still open, so repeated requests skip the TLS handshake.
+ *
+ * Before a slot is handed out its connection is checked: a connection that was closed by the server, has
+ * unexpected data waiting, or has been idle longer than the idle timeout is closed and reopened by the request.
+ * evictIdle() does the same for idle slots from a maintenance task, which gives their TLS memory back, and
+ * warm() opens connections of free slots ahead of the requests that will use them.
+ *
+ * The number of slots is limited by the free heap: every slot needs its arena plus CLIENT_POOL_CONNECTION_HEAP
+ * for the TLS session once connected.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Upper bound for the number of connections (at most 32).
+#ifndef CLIENT_POOL_MAX
+#define CLIENT_POOL_MAX 4
+#endif
+
+// Heap a connected TLS client needs (session, record buffers).
+#ifndef CLIENT_POOL_CONNECTION_HEAP
+#define CLIENT_POOL_CONNECTION_HEAP 40960
+#endif
+
+// Heap that pool sizing leaves to everything else.
+#ifndef CLIENT_POOL_HEAP_RESERVE
+#define CLIENT_POOL_HEAP_RESERVE 32768
+#endif
+
+// An open connection unused for longer than this is closed instead of reused (ms), see setIdleTimeout().
+#ifndef CLIENT_POOL_IDLE_TIMEOUT
+#define CLIENT_POOL_IDLE_TIMEOUT 60000
+#endif
+
+static_assert(CLIENT_POOL_MAX > 0 && CLIENT_POOL_MAX <= 32, "CLIENT_POOL_MAX must be between 1 and 32");
+
+#if defined(ESP32)
+
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include "RequestArena.hpp"
+
+struct ClientPoolStats {
+  uint32_t checkouts = 0;  // Slots handed out.
+  uint32_t reused = 0;     // ... with a connection that was still open.
+  uint32_t waits = 0;      // Checkouts that had to wait for a busy slot.
+  uint32_t timeouts = 0;   // Checkouts that gave up.
+  uint32_t evicted = 0;    // Connections closed as idle or unhealthy.
+};
+
+template <typename Transport>
+class ClientPool {
+public:
+  struct Slot {
+    Transport client;
+    RequestArena arena;
+    unsigned long lastUsed = 0;
+    std::atomic<bool> open{false};
+  };
+
+  ClientPool() {}
+
+  ClientPool(const ClientPool&) = delete;
+  ClientPool& operator=(const ClientPool&) = delete;
+
+  // Creates up to `connections` slots, as many as the free heap allows (at least one if its arena fits).
+  // Returns the number of slots. Must not run while slots are checked out.
+  size_t begin(size_t connections, size_t arenaSize) {
+    end();
+    connections = std::min<size_t>(connections, CLIENT_POOL_MAX);
+    size_t free = ESP.getFreeHeap();
+    size_t budget = free > CLIENT_POOL_HEAP_RESERVE ? free - CLIENT_POOL_HEAP_RESERVE : 0;
+    size_t affordable = budget / (arenaSize + sizeof(Slot) + CLIENT_POOL_CONNECTION_HEAP);
+    connections = std::min(connections, std::max<size_t>(affordable, 1));
+    _slots.reset(new (std::nothrow) Slot[connections]);
+    if (!_slots) {
+      return 0;
+    }
+    _size = 0;
+    while (_size < connections && _slots[_size].arena.begin(arenaSize)) {
+      _slots[_size].client.setKeepAlive(true);
+      _size++;
+    }
+    _busy.store(0);
+    for (std::atomic<uint32_t>* counter : {&_stats.checkouts, &_stats.reused, &_stats.waits, &_stats.timeouts, &_stats.evicted}) {
+      counter->store(0, std::memory_order_relaxed);
+    }
+    return _size;
+  }
+
+  void end() {
+    for (size_t i = 0; i < _size; i++) {
+      _slots[i].client.close();
+    }
+    _slots.reset();
+    _size = 0;
+  }
+
+  // Takes a free slot, waiting up to `timeoutMs` for one; nullptr on timeout. Give it back with release().
+  Slot* checkout(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    bool waited = false;
+    while (true) {
+      uint32_t busy = _busy.load(std::memory_order_relaxed);
+      int index = _pick(busy);
+      if (index < 0) {
+        if (millis() - start >= timeoutMs) {
+          _count(_stats.timeouts);
+          return nullptr;
+        }
+        if (!waited) {
+          waited = true;
+          _count(_stats.waits);
+        }
+        delay(1);
+        continue;
+      }
+      uint32_t bit = 1u << index;
+      if (!_busy.compare_exchange_weak(busy, busy | bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+        continue;
+      }
+      Slot& slot = _slots[index];
+      _count(_stats.checkouts);
+      if (slot.open.load(std::memory_order_relaxed)) {
+        if (millis() - slot.lastUsed > _idleTimeout || !slot.client.healthy()) {
+          slot.client.close();
+          slot.open.store(false, std::memory_order_relaxed);
+          _count(_stats.evicted);
+        } else {
+          _count(_stats.reused);
+        }
+      }
+      return &slot;
+    }
+  }
+
+  void release(Slot* slot) {
+    if (!slot) {
+      return;
+    }
+    slot->lastUsed = millis();
+    slot->open.store(slot->client.healthy(), std::memory_order_relaxed);
+    _busy.fetch_and(~(1u << (slot - _slots.get())), std::memory_order_release);
+  }
+
+  // Closes connections of free slots that have been idle for `maxIdleMs`. Returns how many were closed.
+  size_t evictIdle(uint32_t maxIdleMs) {
+    size_t closed = 0;
+    for (size_t i = 0; i < _size; i++) {
+      uint32_t bit = 1u << i;
+      uint32_t busy = _busy.load(std::memory_order_relaxed);
+      if ((busy & bit) || !_slots[i].open.load(std::memory_order_relaxed)) {
+        continue;
+      }
+      if (!_busy.compare_exchange_strong(busy, busy | bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+        continue;
+      }
+      if (millis() - _slots[i].lastUsed >= maxIdleMs) {
+        _slots[i].client.close();
+        _slots[i].open.store(false, std::memory_order_relaxed);
+        _count(_stats.evicted);
+        closed++;
+      }
+      _busy.fetch_and(~bit, std::memory_order_release);
+    }
+    return closed;
+  }
+
+  size_t evictIdle() {
+    return evictIdle(_idleTimeout);
+  }
+
+  // Opens connections of free slots until `count` are open, with `open(client, arena)` (which returns false
+  // if it failed). Returns the number of open connections.
+  template <typename F>
+  size_t warm(size_t count, F open) {
+    size_t opened = 0;
+    for (size_t i = 0; i < _size && opened < count; i++) {
+      Slot& slot = _slots[i];
+      uint32_t bit = 1u << i;
+      uint32_t busy = _busy.load(std::memory_order_relaxed);
+      if (busy & bit) {
+        // In use; its connection is open unless the request is opening it.
+        opened += slot.open.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (!_busy.compare_exchange_strong(busy, busy | bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+        continue;
+      }
+      if (slot.open.load(std::memory_order_relaxed) && slot.client.healthy()) {
+        opened++;
+      } else {
+        slot.client.close();
+        if (open(slot.client, slot.arena)) {
+          slot.lastUsed = millis();
+          opened++;
+        }
+        slot.open.store(slot.client.healthy(), std::memory_order_relaxed);
+      }
+      _busy.fetch_and(~bit, std::memory_order_release);
+    }
+    return opened;
+  }
+
+  // Slots whose connection is open (as of their last use).
+  size_t openCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < _size; i++) {
+      count += _slots[i].open.load(std::memory_order_relaxed);
+    }
+    return count;
+  }
+
+  void setIdleTimeout(uint32_t idleMs) {
+    _idleTimeout = idleMs;
+  }
+
+  uint32_t getIdleTimeout() const {
+    return _idleTimeout;
+  }
+
+  size_t size() const { return _size; }
+
+  size_t inUse() const {
+    return __builtin_popcount(_busy.load(std::memory_order_relaxed));
+  }
+
+  ClientPoolStats stats() const {
+    ClientPoolStats copy;
+    copy.checkouts = _stats.checkouts.load(std::memory_order_relaxed);
+    copy.reused = _stats.reused.load(std::memory_order_relaxed);
+    copy.waits = _stats.waits.load(std::memory_order_relaxed);
+    copy.timeouts = _stats.timeouts.load(std::memory_order_relaxed);
+    copy.evicted = _stats.evicted.load(std::memory_order_relaxed);
+    return copy;
+  }
+
+private:
+  struct Counters {
+    std::atomic<uint32_t> checkouts{0};
+    std::atomic<uint32_t> reused{0};
+    std::atomic<uint32_t> waits{0};
+    std::atomic<uint32_t> timeouts{0};
+    std::atomic<uint32_t> evicted{0};
+  };
+
+  std::unique_ptr<Slot[]> _slots;
+  size_t _size = 0;
+  std::atomic<uint32_t> _busy{0};
+  uint32_t _idleTimeout = CLIENT_POOL_IDLE_TIMEOUT;
+  Counters _stats;
+
+  static void _count(std::atomic<uint32_t>& counter) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // A free slot, preferring one with an open connection; -1 if all are busy.
+  int _pick(uint32_t busy) {
+    int any = -1;
+    for (size_t i = 0; i < _size; i++) {
+      if (busy & (1u << i)) {
+        continue;
+      }
+      if (_slots[i].open.load(std::memory_order_relaxed)) {
+        return i;
+      }
+      if (any < 0) {
+        any = i;
+      }
+    }
+    return any;
+  }
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * EmbeddingIndex.hpp - A compact int8-quantized embedding index with top-k dot-product search for ESP8266/ESP32.
+ *
+ * Embeddings returned by the Gemini `embedContent` / `batchEmbedContents` endpoints are quantized to int8 while
+ * they are streamed out of the response, so a 768 dimensional vector costs 768 bytes plus one float instead of 3 KB.
+ * Vectors can live in a caller-provided RAM buffer (built at runtime) or in a read-only table stored in flash.
+ *
+ * Features:
+ * - Streaming float -> int8 quantizer with a per-vector scale (no intermediate float array or String)
+ * - Cosine similarity from integer dot products and a per-vector float scale
+ * - Top-k search with an insertion-sorted result list (no heap usage)
+ * - Unrolled four-accumulator scalar dot product (no target-specific SIMD path)
+ * - PROGMEM aware reads for flash-resident indexes on ESP8266
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+#ifndef EMBEDDING_FLASH_CHUNK
+#define EMBEDDING_FLASH_CHUNK 64
+#endif
+
+// Matches report ids as uint16_t, so an index holds at most this many vectors.
+#define EMBEDDING_MAX_VECTORS 65536
+
+struct EmbeddingMatch {
+  uint16_t id;
+  float score;
+};
+
+// The norm of a streamed vector is only known at its end, and embeddings aren't always unit vectors
+// (gemini-embedding-001 truncated to 768 or 1536 dimensions isn't normalized). So the scale is chosen per vector:
+// the first nonzero value is mapped onto the upper half of the int8 range, and whenever a later value doesn't
+// fit, the scale and the values already written are halved. The largest component always ends up in 64..127,
+// whatever the vector's norm.
+class EmbeddingQuantizer {
+public:
+  EmbeddingQuantizer(int8_t* out, size_t dims)
+    : _out(out), _dims(dims), _count(0), _sumSquares(0), _scale(defaultScale(dims)), _scaled(false) {}
+
+  // Scale before the first value: components of a unit vector are ~N(0, 1/dims), and this maps +-4 sigma onto
+  // the int8 range.
+  static float defaultScale(size_t dims) {
+    return 127.0f * sqrtf((float)dims) / 4.0f;
+  }
+
+  void push(float v) {
+    if (_count >= _dims) return;
+    if (!isfinite(v)) v = 0;
+    _sumSquares += v * v;
+    if (!_scaled && v != 0) {
+      while (fabsf(v * _scale) < 63.75f && _scale < 1e30f) _scale *= 2.0f;
+      _scaled = true;
+    }
+    while (fabsf(v * _scale) >= 127.5f) {
+      _halve();
+    }
+    _out[_count++] = (int8_t)lroundf(v * _scale);
+  }
+
+  // Zero fills the rest of the vector if the response had fewer values than expected.
+  void finish() {
+    while (_count < _dims) _out[_count++] = 0;
+  }
+
+  size_t count() const { return _count; }
+  float scale() const { return _scale; }
+
+  // Multiplying an int8 dot product by both vectors' invNorm() yields their cosine similarity.
+  float invNorm() const {
+    return _sumSquares > 0 ? 1.0f / (_scale * sqrtf(_sumSquares)) : 0.0f;
+  }
+
+private:
+  int8_t* _out;
+  size_t _dims;
+  size_t _count;
+  float _sumSquares;
+  float _scale;
+  bool _scaled;
+
+  void _halve() {
+    _scale *= 0.5f;
+    for (size_t i = 0; i < _count; i++) {
+      // Rounds halves to even, so values halved several times don't drift away from zero.
+      int q = _out[i] >> 1;
+      _out[i] = (int8_t)((_out[i] & 1) ? q + (q & 1) : q);
+    }
+  }
+};
+
+class EmbeddingIndex {
+public:
+  // Writable index in RAM: `vectors` holds capacity * dims bytes, `invNorms` holds capacity floats.
+  // A capacity above EMBEDDING_MAX_VECTORS is cut to it.
+  EmbeddingIndex(int8_t* vectors, float* invNorms, size_t capacity, size_t dims)
+    : _vectors(vectors), _invNorms(invNorms), _writable(vectors), _writableNorms(invNorms),
+      _capacity(std::min(capacity, (size_t)EMBEDDING_MAX_VECTORS)), _count(0), _dims(dims), _flash(false) {}
+
+  // Read-only index stored in flash (PROGMEM), e.g. generated offline from getEmbeddings(). Only the first
+  // EMBEDDING_MAX_VECTORS are searched.
+  EmbeddingIndex(const int8_t* vectors, const float* invNorms, size_t count, size_t dims)
+    : _vectors(vectors), _invNorms(invNorms), _writable(nullptr), _writableNorms(nullptr),
+      _capacity(std::min(count, (size_t)EMBEDDING_MAX_VECTORS)), _count(_capacity), _dims(dims), _flash(true) {}
+
+  size_t size() const { return _count; }
+  size_t capacity() const { return _capacity; }
+  size_t dims() const { return _dims; }
+
+  // Slot for the next vector, so embeddings can be quantized straight into the index. nullptr when full.
+  int8_t* nextSlot() {
+    if (!_writable || _count >= _capacity) return nullptr;
+    return _writable + _count * _dims;
+  }
+
+  int commit(float invNorm) {
+    if (!_writable || _count >= _capacity) return -1;
+    _writableNorms[_count] = invNorm;
+    return (int)_count++;
+  }
+
+  int add(const int8_t* vector, float invNorm) {
+    int8_t* slot = nextSlot();
+    if (!slot) return -1;
+    memcpy(slot, vector, _dims);
+    return commit(invNorm);
+  }
+
+  void clear() {
+    if (_writable) _count = 0;
+  }
+
+  float score(const int8_t* query, float queryInvNorm, size_t id) const {
+    if (id >= _count) return 0;
+    return (float)_dotAt(query, id) * queryInvNorm * _invNormAt(id);
+  }
+
+  // Fills `out` with up to k best matches sorted by descending cosine similarity. Returns the number found.
+  size_t search(const int8_t* query, float queryInvNorm, EmbeddingMatch* out, size_t k) const {
+    size_t found = 0;
+    if (k == 0) return 0;
+    for (size_t id = 0; id < _count; id++) {
+      float s = score(query, queryInvNorm, id);
+      if (found == k && s <= out[k - 1].score) continue;
+      size_t pos = (found < k) ? found++ : k - 1;
+      while (pos > 0 && out[pos - 1].score < s) {
+        out[pos] = out[pos - 1];
+        pos--;
+      }
+      out[pos].id = (uint16_t)id;
+      out[pos].score = s;
+    }
+    return found;
+  }
+
+  // Plain scalar code on every target. Xtensa GCC doesn't vectorize it, and esp-dsp's dsps_dotprod_s8 on the
+  // ESP32-S3 returns an int16 scaled by a shift, which loses the precision of long (768-dim) vectors.
+  static int32_t dot(const int8_t* a, const int8_t* b, size_t n) {
+    int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      s0 += (int16_t)a[i]     * b[i]     + (int16_t)a[i + 4] * b[i + 4];
+      s1 += (int16_t)a[i + 1] * b[i + 1] + (int16_t)a[i + 5] * b[i + 5];
+      s2 += (int16_t)a[i + 2] * b[i + 2] + (int16_t)a[i + 6] * b[i + 6];
+      s3 += (int16_t)a[i + 3] * b[i + 3] + (int16_t)a[i + 7] * b[i + 7];
+    }
+    for (; i < n; i++) s0 += (int16_t)a[i] * b[i];
+    return s0 + s1 + s2 + s3;
+  }
+
+private:
+  const int8_t* _vectors;
+  const float* _invNorms;
+  int8_t* _writable;
+  float* _writableNorms;
+  size_t _capacity;
+  size_t _count;
+  size_t _dims;
+  bool _flash;
+
+  int32_t _dotAt(const int8_t* query, size_t id) const {
+    const int8_t* row = _vectors + id * _dims;
+    #ifdef ESP8266
+      if (_flash) {
+        // Flash on ESP8266 only allows aligned 32-bit reads, so rows are copied through a small stack chunk.
+        int8_t chunk[EMBEDDING_FLASH_CHUNK];
+        int32_t sum = 0;
+        for (size_t off = 0; off < _dims; off += EMBEDDING_FLASH_CHUNK) {
+          size_t n = std::min((size_t)EMBEDDING_FLASH_CHUNK, _dims - off);
+          memcpy_P(chunk, row + off, n);
+          sum += dot(query + off, chunk, n);
+        }
+        return sum;
+      }
+    #endif
+    return dot(query, row, _dims);
+  }
+
+  float _invNormAt(size_t id) const {
+    #ifdef ESP8266
+      if (_flash) {
+        float v;
+        memcpy_P(&v, _invNorms + id, sizeof(v));
+        return v;
+      }
+    #endif
+    return _invNorms[id];
+  }
+};
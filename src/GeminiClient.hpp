@@ -3,14 +3,21 @@
 #define GEMINI_AI_VERSION "6.6.0"
 
 #include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <new>
 #include "Google_ROOTCa.h"
+#include "GzipStream.hpp"
+#include "RequestArena.hpp"
+#include "TrafficCapture.hpp"
 
 #ifdef ESP8266
-  #include <memory>
   #include <WiFiClientSecure.h>
   #define SECURE_CLIENT WiFiClientSecure
 #elif defined(ESP32)
+  #include <WiFi.h>
   #include <NetworkClientSecure.h>
+  #include <atomic>
   #define SECURE_CLIENT NetworkClientSecure
 #endif
 
@@ -20,6 +27,11 @@
 #define HTTPC_ERROR_NOT_CONNECTED       (-4)
 #define HTTPC_ERROR_CONNECTION_LOST     (-5)
 #define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#ifndef HEADER_BUFFER_SIZE
+  #define HEADER_BUFFER_SIZE 512
+#endif
 
 #ifdef DEBUG
   #define debug(x)      do { Serial.print(F("GeminiClient: ")); Serial.print(x); } while(0)
@@ -33,6 +45,226 @@
   #define debuglnF(x)
 #endif
 
+// Decodes an HTTP/1.1 "Transfer-Encoding: chunked" body into the plain payload bytes.
+class ChunkedStream : public Stream {
+  public:
+    ChunkedStream(Stream& source, uint16_t timeout) : _source(source), _timeout(timeout) {}
+
+    int available() override {
+      if (_left == 0 && !_ended && _source.available() > 0) {
+        nextChunk();
+      }
+      if (_left == 0) {
+        return 0;
+      }
+      return std::min((uint32_t)std::max(_source.available(), 0), _left);
+    }
+
+    int peek() override {
+      return available() ? _source.peek() : -1;
+    }
+
+    int read() override {
+      if (!available()) {
+        return -1;
+      }
+      _left--;
+      return _source.read();
+    }
+
+    size_t write(uint8_t) override {
+      return 0;
+    }
+
+    bool ended() {
+      return _ended;
+    }
+
+    // Consumes the rest of the body (at most `limit` bytes) and the trailer, so the connection can carry
+    // the next response. False if the end isn't reached.
+    bool finish(uint32_t limit) {
+      unsigned long start = millis();
+      while (!_ended) {
+        if (available() > 0) {
+          if (limit-- == 0) {
+            return false;
+          }
+          read();
+          start = millis();
+        } else if (millis() - start > _timeout) {
+          return false;
+        } else {
+          delay(1);
+        }
+      }
+      uint8_t length = 0;
+      int c;
+      while ((c = waitByte()) >= 0) {
+        if (c == '\n') {
+          if (length == 0) {
+            return true;
+          }
+          length = 0;
+        } else if (c != '\r' && ++length >= MAX_LINE) {
+          return false;
+        }
+      }
+      return false;
+    }
+
+  private:
+    int waitByte() {
+      unsigned long start = millis();
+      while (_source.available() <= 0) {
+        if (millis() - start > _timeout) {
+          return -1;
+        }
+        delay(1);
+      }
+      return _source.read();
+    }
+
+    // A chunk-size line longer than this ends the body, so a broken peer can't keep us reading one line forever.
+    static constexpr uint8_t MAX_LINE = 128;
+
+    void nextChunk() {
+      int c;
+      uint8_t length = 0;
+      if (!_first) {
+        while ((c = waitByte()) >= 0 && c != '\n' && ++length < MAX_LINE);
+      }
+      _first = false;
+      uint32_t size = 0;
+      bool extension = false;
+      length = 0;
+      while ((c = waitByte()) >= 0 && c != '\n') {
+        if (++length >= MAX_LINE) {
+          debuglnF("Chunk header too long!");
+          size = 0;
+          break;
+        }
+        if (extension || c == '\r') {
+          continue;
+        } else if (c == ';') {
+          extension = true;
+        } else if (isxdigit(c)) {
+          size = (size << 4) | (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+        }
+      }
+      _left = size;
+      _ended = (size == 0);
+    }
+
+    Stream& _source;
+    uint16_t _timeout;
+    uint32_t _left = 0;
+    bool _first = true;
+    bool _ended = false;
+};
+
+// A "Content-Length" body: ends after exactly that many bytes instead of when the connection closes.
+class FixedLengthStream : public Stream {
+  public:
+    FixedLengthStream(Stream& source, uint32_t length, uint16_t timeout) : _source(source), _left(length), _timeout(timeout) {}
+
+    int available() override {
+      return std::min((uint32_t)std::max(_source.available(), 0), _left);
+    }
+
+    int peek() override {
+      return available() ? _source.peek() : -1;
+    }
+
+    int read() override {
+      if (!available()) {
+        return -1;
+      }
+      _left--;
+      return _source.read();
+    }
+
+    size_t write(uint8_t) override {
+      return 0;
+    }
+
+    bool ended() {
+      return _left == 0;
+    }
+
+    // Consumes the rest of the body, at most `limit` bytes. False if the end isn't reached.
+    bool finish(uint32_t limit) {
+      if (_left > limit) {
+        return false;
+      }
+      unsigned long start = millis();
+      while (_left > 0) {
+        if (available() > 0) {
+          read();
+          start = millis();
+        } else if (millis() - start > _timeout) {
+          return false;
+        } else {
+          delay(1);
+        }
+      }
+      return true;
+    }
+
+  private:
+    Stream& _source;
+    uint32_t _left;
+    uint16_t _timeout;
+};
+
+// Bytes of an unread response body that end() still drains to keep the connection; larger ones close it.
+#ifndef KEEPALIVE_DRAIN_LIMIT
+  #define KEEPALIVE_DRAIN_LIMIT 4096
+#endif
+
+// How long a resolved address of the API host is used (ms). Arduino's resolver doesn't return the record's
+// TTL, so this follows the 300 s that Google's records carry.
+#ifndef GEMINI_DNS_TTL
+  #define GEMINI_DNS_TTL 300000
+#endif
+
+#if defined(ESP32)
+// The resolved IPv4 address of the API host, shared by all clients. A new connection then starts with the TCP
+// handshake instead of a DNS query. ESP8266 can't pass the host name for TLS with an address, and relies on
+// lwIP's own DNS cache instead.
+class HostCache {
+  public:
+    static bool resolve(const char* host, IPAddress& ip) {
+      uint32_t address = _address.load(std::memory_order_relaxed);
+      if (address != 0 && millis() - _resolvedAt.load(std::memory_order_relaxed) < GEMINI_DNS_TTL) {
+        ip = IPAddress(address);
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      if (!WiFi.hostByName(host, ip) || (uint32_t)ip == 0) {
+        return false;
+      }
+      _resolvedAt.store(millis(), std::memory_order_relaxed);
+      _address.store((uint32_t)ip, std::memory_order_relaxed);
+      return true;
+    }
+
+    // Forgets the address, e.g. after a connection to it failed.
+    static void invalidate() {
+      _address.store(0, std::memory_order_relaxed);
+    }
+
+    // Connections that skipped the DNS query.
+    static uint32_t hits() {
+      return _hits.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static inline std::atomic<uint32_t> _address{0};
+    static inline std::atomic<uint32_t> _resolvedAt{0};
+    static inline std::atomic<uint32_t> _hits{0};
+};
+#endif
+
 class GeminiClient {
 
   public:
@@ -45,50 +277,218 @@ class GeminiClient {
       clear();
       _model = model;
       _apiKey = apiKey;
+      _path = "";
+      _action = "generateContent";
+      _connectTime = 0;
+      _warm = false;
+      if (_client.connected()) {
+        // A kept-alive connection is already set up.
+        return true;
+      }
+      _insecure = !secure(_client);
+      return true;
+    }
+
+    // Sets up certificate verification for the API host, also for other connections to it (GeminiLive).
+    // Returns false if it had to fall back to an unverified connection.
+    static bool secure(SECURE_CLIENT& client) {
       #ifdef ESP8266
-        if (!_client.probeMaxFragmentLength("generativelanguage.googleapis.com", 443, 4096)) {
+        if (!client.probeMaxFragmentLength("generativelanguage.googleapis.com", 443, 4096)) {
           debuglnF("Failed to set probeMaxFragmentLength");
         }
-        if (!_client.setCACert_P(google_root_ca)) {
+        if (!client.setCACert_P(google_root_ca)) {
           debuglnF("CA cert failed. Trying SHA1 fingerprint...");
-          if (!_client.setFingerprint(GEMINI_SHA1_FINGERPRINT)) {
+          if (!client.setFingerprint(GEMINI_SHA1_FINGERPRINT)) {
             debuglnF("Fingerprint failed. Falling back to insecure.");
-            _client.setInsecure();
+            client.setInsecure();
+            return false;
           }
         } else {
           debuglnF("Using CA certificate.");
         }
       #elif defined(ESP32)
-        _client.setBufferSizes(4096, 4096);
-        if (!_client.setCACert(google_root_ca)) {
+        client.setBufferSizes(4096, 4096);
+        if (!client.setCACert(google_root_ca)) {
           debuglnF("CA cert failed. Falling back to insecure.");
-          _client.setInsecure();
-        } else {
-          debuglnF("Using CA certificate.");
+          client.setInsecure();
+          return false;
         }
+        debuglnF("Using CA certificate.");
       #endif
       return true;
     }
 
+    // Opens the TCP and TLS connection to the API host, set up with secure(). On ESP32 the address comes from
+    // the HostCache.
+    static bool open(SECURE_CLIENT& client, bool verified, int32_t connectTimeout, uint16_t tcpTimeout) {
+      #ifdef ESP32
+        (void)tcpTimeout;
+        IPAddress ip;
+        bool cached = HostCache::resolve("generativelanguage.googleapis.com", ip);
+        client.setTimeout(connectTimeout);
+        // The host name still goes along for SNI and certificate verification.
+        if (!cached || !client.connect(ip, 443, "generativelanguage.googleapis.com", verified ? google_root_ca : nullptr, nullptr, nullptr)) {
+          HostCache::invalidate();
+          return client.connect("generativelanguage.googleapis.com", 443, connectTimeout);
+        }
+        return true;
+      #else
+        (void)verified;
+        (void)connectTimeout;
+        client.setTimeout(tcpTimeout);
+        return client.connect("generativelanguage.googleapis.com", 443);
+      #endif
+    }
+
     void end() {
-      if (_client.connected()) {
+      if (_gzipStream) {
+        debugF("gzip: ");
+        debug(_gzipStream->compressedBytes());
+        debugF(" bytes received, ");
+        debug(_gzipStream->inflatedBytes());
+        debuglnF(" bytes inflated.");
+      }
+      if (_capture) {
+        _capture->end();
+      }
+      if (_client.connected() && !(_keepAlive && reusable())) {
         _client.stop();
       }
       clear();
     }
 
+    // Keeps the connection open after end() ("Connection: keep-alive") when the response could be read or
+    // drained to its end, so the next request on this client skips the TLS handshake.
+    void setKeepAlive(bool keepAlive) {
+      _keepAlive = keepAlive;
+    }
+
+    // An open connection with nothing unexpected (e.g. a close notification) waiting on it.
+    bool healthy() {
+      return !_replay && _client.connected() && _client.available() == 0;
+    }
+
+    void close() {
+      if (_client.connected()) {
+        _client.stop();
+      }
+    }
+
+    // Connection setup, and the longest wait for the response headers (both in ms).
+    void setTimeouts(int32_t connectTimeout, uint16_t tcpTimeout) {
+      _connectTimeout = connectTimeout;
+      _tcpTimeout = tcpTimeout;
+    }
+
+    // Opens the connection (DNS, TCP and TLS) without sending a request, after begin(). Keep-alive must be on
+    // for the next request to use it.
+    bool prewarm() {
+      return connect();
+    }
+
+    // How long the last request's connection took to open (ms), 0 if it was already open.
+    uint32_t connectTime() {
+      return _connectTime;
+    }
+
+    // The last request went over a connection that was already open (kept alive or prewarmed).
+    bool warm() {
+      return _warm;
+    }
+
+    // The whole response body has been read (false when its length is unknown).
+    bool bodyEnded() {
+      framing();
+      return _chunkedStream ? _chunkedStream->ended() : _fixedStream && _fixedStream->ended();
+    }
+
     bool connected() {
+      if (_replay) {
+        return !_replay->ended();
+      }
       return (_client.connected() || _client.available() > 0);
     }
 
+    // Records every response byte with its arrival time to `sink` (see TrafficCapture.hpp), nullptr to stop.
+    void setCapture(Print* sink) {
+      _capture.reset(sink ? new (std::nothrow) CaptureStream(_client, *sink) : nullptr);
+    }
+
+    // Serves responses from a recorded capture instead of the network; requests are discarded.
+    void setReplay(ReplayStream* replay) {
+      _replay = replay;
+    }
+
+    void setAction(const String& action) {
+      _action = action;
+    }
+
+    // Full request path (e.g. "/v1beta/cachedContents"), overrides the model/action path when set.
+    void setPath(const String& path) {
+      _path = path;
+    }
+
     int POST(const String& payload) {
       return sendRequest("POST", (uint8_t*)payload.c_str(), payload.length());
     }
 
+    int POST(const char* payload, size_t size) {
+      return sendRequest("POST", (uint8_t*)payload, size);
+    }
+
+    // Streams a body too large for a single buffer. `writeBody` must write exactly `size` bytes.
+    int POST(size_t size, std::function<void(Print&)> writeBody) {
+      return exchange("POST", size, [&]() {
+        writeBody(output());
+        return true;
+      });
+    }
+
+    int PATCH(const String& payload) {
+      return sendRequest("PATCH", (uint8_t*)payload.c_str(), payload.length());
+    }
+
+    int DELETE() {
+      return sendRequest("DELETE", nullptr, 0);
+    }
+
     SECURE_CLIENT &getStream() {
       return _client;
     }
 
+    // Response body with the transfer (chunked) and content (gzip) encodings removed.
+    Stream &getBodyStream() {
+      Stream* body = framing();
+      if (_gzip) {
+        if (!_gzipStream) {
+          uint8_t* window = _arena ? (uint8_t*)_arena->allocate(GZIP_WINDOW_SIZE, 1) : nullptr;
+          _gzipStream = window ? create<GzipStream>(*body, window, (size_t)GZIP_WINDOW_SIZE) : create<GzipStream>(*body);
+          if (_gzipStream) {
+            _gzipStream->setTimeouts(_responseIdleTimeout, _responseTotalTimeout);
+          }
+        }
+        if (_gzipStream) {
+          body = _gzipStream;
+        }
+      }
+      return *body;
+    }
+
+    // Deadlines for reading the response body through the gzip decoder (ms), normally those of the JSON reader.
+    void setResponseTimeouts(uint32_t idleTimeout, uint32_t totalTimeout) {
+      _responseIdleTimeout = idleTimeout;
+      _responseTotalTimeout = totalTimeout;
+    }
+
+    // Per-request scratch memory (header, body decoders) comes from `arena` when set.
+    void setArena(RequestArena* arena) {
+      _arena = arena;
+    }
+
+    void setAcceptGzip(bool accept) {
+      _acceptGzip = accept;
+    }
+
     static String errorToString(int error) {
       switch (error) {
         case HTTPC_ERROR_CONNECTION_REFUSED: return F("connection refused");
@@ -97,6 +497,7 @@ class GeminiClient {
         case HTTPC_ERROR_NOT_CONNECTED: return F("not connected");
         case HTTPC_ERROR_CONNECTION_LOST: return F("connection lost");
         case HTTPC_ERROR_NO_HTTP_SERVER: return F("no HTTP server");
+        case HTTPC_ERROR_READ_TIMEOUT: return F("read timeout");
         default: return String(error);
       }
     }
@@ -105,28 +506,101 @@ class GeminiClient {
     void clear() {
       _returnCode = 0;
       _size = -1;
+      _chunked = false;
+      _gzip = false;
+      _serverClose = false;
+      destroy(_gzipStream);
+      destroy(_chunkedStream);
+      destroy(_fixedStream);
+    }
+
+    // The body with only the transfer framing (chunked or Content-Length) removed.
+    Stream* framing() {
+      Stream* body = &input();
+      if (_chunked) {
+        if (!_chunkedStream) {
+          _chunkedStream = create<ChunkedStream>(*body, _tcpTimeout);
+        }
+        if (_chunkedStream) {
+          body = _chunkedStream;
+        }
+      } else if (_size >= 0 && _returnCode > 0) {
+        if (!_fixedStream) {
+          _fixedStream = create<FixedLengthStream>(*body, (uint32_t)_size, _tcpTimeout);
+        }
+        if (_fixedStream) {
+          body = _fixedStream;
+        }
+      }
+      return body;
+    }
+
+    // Whether the connection can carry another request: the response was complete and its body is drained.
+    bool reusable() {
+      if (_replay || _returnCode <= 0 || _serverClose || (!_chunked && _size < 0)) {
+        return false;
+      }
+      framing();
+      if (_chunkedStream) {
+        return _chunkedStream->finish(KEEPALIVE_DRAIN_LIMIT);
+      }
+      return _fixedStream && _fixedStream->finish(KEEPALIVE_DRAIN_LIMIT);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      void* memory = _arena ? _arena->allocate(sizeof(T), alignof(T)) : nullptr;
+      return memory ? new (memory) T(std::forward<Args>(args)...) : new (std::nothrow) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void destroy(T*& object) {
+      if (!object) {
+        return;
+      }
+      if (_arena && _arena->owns(object)) {
+        object->~T();
+      } else {
+        delete object;
+      }
+      object = nullptr;
+    }
+
+    // Where response bytes come from: the socket, the socket through the capture, or a replay.
+    Stream& input() {
+      if (_replay) return *_replay;
+      if (_capture) return *_capture;
+      return _client;
+    }
+
+    Print& output() {
+      static NullPrint discard;
+      return _replay ? (Print&)discard : (Print&)_client;
+    }
+
+    static bool isHeader(const String& line, const char* name) {
+      size_t length = strlen(name);
+      return line.length() > length && strncasecmp(line.c_str(), name, length) == 0;
     }
 
     bool connect() {
+      if (_replay) {
+        return _replay->nextResponse();
+      }
       if (connected()) {
         while (_client.available() > 0) {
           _client.read();
         }
+        _warm = true;
         return true;
       }
       debuglnF("Connecting to generativelanguage.googleapis.com...");
-      #ifdef ESP32
-        if (!_client.connect("generativelanguage.googleapis.com", 443, _connectTimeout)) {
-          debuglnF("Connection failed!");
-          return false;
-        }
-      #else
-        _client.setTimeout(_tcpTimeout);
-        if (!_client.connect("generativelanguage.googleapis.com", 443)) {
-          debuglnF("Connection failed!");
-          return false;
-        }
-      #endif
+      unsigned long start = millis();
+      if (!open(_client, !_insecure, _connectTimeout, _tcpTimeout)) {
+        debuglnF("Connection failed!");
+        return false;
+      }
+      _connectTime = std::max<uint32_t>(millis() - start, 1);
       debuglnF("Connected successfully.");
       return connected();
     }
@@ -135,16 +609,36 @@ class GeminiClient {
       if (!connected()) {
         return false;
       }
-      String header = String(type) + " /v1beta/models/" + _model + ":generateContent HTTP/1.1\r\n";
-      header += "Host: generativelanguage.googleapis.com\r\n";
-      header += "User-Agent: Gemini_AI/" GEMINI_AI_VERSION "\r\n";
-      header += "Connection: close\r\n";
-      header += "Content-Type: application/json\r\n";
-      header += "Accept: application/json\r\n";
-      header += "X-goog-api-key: " + _apiKey + "\r\n";
-      header += "Content-Length: " + String(payloadSize) + "\r\n\r\n";
+      std::unique_ptr<char[]> owned;
+      char* header = _arena ? (char*)_arena->allocate(HEADER_BUFFER_SIZE, 1) : nullptr;
+      if (!header) {
+        owned.reset(new (std::nothrow) char[HEADER_BUFFER_SIZE]);
+        header = owned.get();
+        if (!header) {
+          debuglnF("Failed to allocate header buffer!");
+          return false;
+        }
+      }
+      bool custom = _path.length() > 0;
+      int length = snprintf(header, HEADER_BUFFER_SIZE,
+        "%s %s%s%s%s HTTP/1.1\r\n"
+        "Host: generativelanguage.googleapis.com\r\n"
+        "User-Agent: Gemini_AI/" GEMINI_AI_VERSION "%s\r\n"
+        "Connection: %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Accept: application/json\r\n"
+        "%s"
+        "X-goog-api-key: %s\r\n"
+        "Content-Length: %u\r\n\r\n",
+        type, custom ? _path.c_str() : "/v1beta/models/", custom ? "" : _model.c_str(), custom ? "" : ":", custom ? "" : _action.c_str(),
+        _acceptGzip ? " (gzip)" : "", _keepAlive ? "keep-alive" : "close", _acceptGzip ? "Accept-Encoding: gzip\r\n" : "",
+        _apiKey.c_str(), (unsigned)payloadSize);
+      if (length <= 0 || length >= HEADER_BUFFER_SIZE) {
+        debuglnF("Header buffer too small!");
+        return false;
+      }
 
-      if (_client.write((const uint8_t*)header.c_str(), header.length()) != header.length()) {
+      if (output().write((const uint8_t*)header, length) != (size_t)length) {
         debuglnF("Header send failed.");
         return false;
       }
@@ -159,9 +653,17 @@ class GeminiClient {
       _returnCode = 0;
       bool firstLine = true;
       unsigned long start = millis();
+      if (_capture) {
+        _capture->begin();
+      }
+      Stream& in = input();
+      if (&in != &_client) {
+        in.setTimeout(_tcpTimeout);
+      }
       while (connected()) {
-        if (_client.available() > 0) {
-          String line = _client.readStringUntil('\n');
+        if (in.available() > 0) {
+          _responseStarted = true;
+          String line = in.readStringUntil('\n');
           line.trim();
           if (firstLine) {
             firstLine = false;
@@ -175,10 +677,16 @@ class GeminiClient {
               debuglnF("Failed to parse HTTP status code!");
               _returnCode = 0;
             }
-          } else if (line.startsWith("Content-Length:")) {
+          } else if (isHeader(line, "Content-Length:")) {
             _size = line.substring(15).toInt();
             debugF("Content-Length: ");
             debugln(_size);
+          } else if (isHeader(line, "Content-Encoding:")) {
+            _gzip = line.indexOf("gzip") > 0;
+          } else if (isHeader(line, "Transfer-Encoding:")) {
+            _chunked = line.indexOf("chunked") > 0;
+          } else if (isHeader(line, "Connection:")) {
+            _serverClose = line.indexOf("close") > 0;
           }
           if (line == "") {
             if (_returnCode > 0) {
@@ -192,7 +700,7 @@ class GeminiClient {
         }
         if (millis() - start > _tcpTimeout) {
           debuglnF("Timeout while reading headers!");
-          break;
+          return HTTPC_ERROR_READ_TIMEOUT;
         }
         yield();
       }
@@ -201,26 +709,65 @@ class GeminiClient {
     }
 
     int sendRequest(const char *type, uint8_t *payload, size_t size) {
-      if (!connect())
-        return HTTPC_ERROR_CONNECTION_REFUSED;
-      }
-      if (!sendHeader(type, size)) {
-        return HTTPC_ERROR_SEND_HEADER_FAILED;
-      }
-      if (size > 0) {
-        if (_client.write(payload, size) != size) {
+      return exchange(type, size, [&]() {
+        if (size > 0 && output().write(payload, size) != size) {
           debuglnF("Payload send failed.");
-          return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+          return false;
         }
+        return true;
+      });
+    }
+
+    // Sends one request. A kept-alive connection the server dropped unnoticed fails while writing, or is
+    // closed before any response byte arrives; the request is then sent once more on a new connection. A
+    // request that may have reached the server (a timeout, or a response that broke off) is never repeated,
+    // it would run and be billed twice.
+    template <typename F>
+    int exchange(const char* type, size_t size, F writeBody) {
+      for (uint8_t attempt = 0; ; attempt++) {
+        _responseStarted = false;
+        if (!connect()) {
+          return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        int code = !sendHeader(type, size) ? HTTPC_ERROR_SEND_HEADER_FAILED
+                 : !writeBody() ? HTTPC_ERROR_SEND_PAYLOAD_FAILED
+                 : handleHeaderResponse();
+        bool dropped = code == HTTPC_ERROR_SEND_HEADER_FAILED || code == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                       ((code == HTTPC_ERROR_CONNECTION_LOST || code == HTTPC_ERROR_NOT_CONNECTED) && !_responseStarted);
+        if (code > 0 || !dropped || !_warm || _replay || attempt > 0) {
+          return code;
+        }
+        debuglnF("Kept-alive connection was closed, reconnecting.");
+        _client.stop();
+        clear();
+        _warm = false;
       }
-      return handleHeaderResponse();
     }
 
     SECURE_CLIENT _client;
+    std::unique_ptr<CaptureStream> _capture;
+    ReplayStream* _replay = nullptr;
     String _model;
     String _apiKey;
+    String _action = "generateContent";
+    String _path;
+    bool _acceptGzip = false;
+    bool _keepAlive = false;
+    bool _serverClose = false;
+    bool _insecure = false;
+    bool _warm = false;
+    bool _responseStarted = false;
+    uint32_t _connectTime = 0;
+    bool _gzip = false;
+    bool _chunked = false;
+    ChunkedStream* _chunkedStream = nullptr;
+    FixedLengthStream* _fixedStream = nullptr;
+    GzipStream* _gzipStream = nullptr;
+    RequestArena* _arena = nullptr;
     uint16_t _tcpTimeout = 5000;
     int32_t _connectTimeout = 10000;
+    uint32_t _responseIdleTimeout = GZIP_WAIT_TIMEOUT;
+    uint32_t _responseTotalTimeout = 0xFFFFFFFF;
     int _returnCode = 0;
     int _size = -1;
 };
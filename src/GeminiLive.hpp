@@ -0,0 +1,482 @@
+/*
+ * GeminiLive.hpp - A bidirectional Gemini Live API session (BidiGenerateContent over WebSocket) for
+ * ESP8266/ESP32, for realtime voice and text.
+ *
+ * One TLS connection stays open for the whole conversation. Text turns and microphone audio (16-bit PCM) go
+ * up as they are produced, and the answer comes back while it is generated, as text or as 24 kHz PCM audio,
+ * together with transcripts of both sides:
+ *
+ *   GeminiLive live;
+ *   live.setModality(LIVE_AUDIO);
+ *   live.begin(apiKey);
+ *   live.sendAudio(samples, count);      // as often as the microphone delivers
+ *   live.endAudio();
+ *   LiveEvents events;
+ *   events.onAudio = [](const uint8_t* pcm, size_t size) { i2s_write(...); };
+ *   live.receiveTurn(events);
+ *
+ * Every server message is read straight off the socket by LiveEventReader (a ResponseEventReader, so text,
+ * code and usage arrive exactly as with generateContent) and audio is base64-decoded into LIVE_AUDIO_CHUNK
+ * blocks on the way; nothing is buffered whole. Outgoing messages are built in one LIVE_PAYLOAD_SIZE buffer,
+ * allocated once in begin(), and masked in place; audio is encoded into that buffer block by block, so a
+ * recording of any length goes out as a single message.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <new>
+#include "GeminiClient.hpp"
+#include "StaticJsonBuilder.hpp"
+#include "ResponseEvents.hpp"
+#include "Base64.hpp"
+#include "WebSocket.hpp"
+
+#ifndef GEMINI_LIVE_MODEL
+#define GEMINI_LIVE_MODEL "gemini-2.0-flash-live-001"
+#endif
+
+// Largest text message (setup, sendText()); audio is sent in blocks of this size.
+#ifndef LIVE_PAYLOAD_SIZE
+#define LIVE_PAYLOAD_SIZE 1024
+#endif
+
+// Decoded audio bytes per onAudio call (at most).
+#ifndef LIVE_AUDIO_CHUNK
+#define LIVE_AUDIO_CHUNK 256
+#endif
+
+// How long begin() waits for the server to accept the setup (ms).
+#ifndef LIVE_SETUP_TIMEOUT
+#define LIVE_SETUP_TIMEOUT 10000
+#endif
+
+// Longest pause within one server message (ms); a message is sent as a whole, so this is short.
+#ifndef LIVE_MESSAGE_TIMEOUT
+#define LIVE_MESSAGE_TIMEOUT 2000
+#endif
+
+// Default for receiveTurn() (ms).
+#ifndef LIVE_TURN_TIMEOUT
+#define LIVE_TURN_TIMEOUT 30000
+#endif
+
+static_assert(LIVE_PAYLOAD_SIZE >= 256, "LIVE_PAYLOAD_SIZE must hold the setup message");
+
+enum LiveModality : uint8_t {
+  LIVE_TEXT,
+  LIVE_AUDIO
+};
+
+// What a server message signalled, returned by poll() as bits.
+enum LiveSignal : uint8_t {
+  LIVE_SETUP_COMPLETE = 0x01,
+  LIVE_TURN_COMPLETE = 0x02,
+  LIVE_INTERRUPTED = 0x04,
+  LIVE_GO_AWAY = 0x08
+};
+
+// Leave a callback empty to skip that kind of content.
+struct LiveEvents : ResponseEvents {
+  std::function<void(const uint8_t* pcm, size_t size)> onAudio;  // Answer audio, 16-bit PCM, 24 kHz.
+  std::function<void(char)> onInputTranscript;                   // What the model heard.
+  std::function<void(char)> onOutputTranscript;                  // What the model said.
+  std::function<void()> onInterrupted;                           // The user spoke over the answer.
+  std::function<void()> onTurnComplete;                          // The model's turn has ended.
+  std::function<void(uint32_t ms)> onGoAway;                     // The server will close the session soon.
+};
+
+// Reads one server message of a Live session.
+class LiveEventReader : public ResponseEventReader {
+public:
+  using ResponseEventReader::ResponseEventReader;
+
+  // Returns the LiveSignal bits of the message.
+  uint8_t read(const LiveEvents& events) {
+    _live = &events;
+    _events = &events;
+    _delivered = 0;
+    _broken = false;
+    uint8_t signals = 0;
+    _skipWhitespace();
+    while (_waitForData() && _stream.peek() != '{') {
+      _stream.read();
+    }
+    _members([&](const char* key) {
+      if (strcmp(key, "setupComplete") == 0) {
+        signals |= LIVE_SETUP_COMPLETE;
+        return false;
+      }
+      if (strcmp(key, "serverContent") == 0) {
+        signals |= _serverContent();
+        return true;
+      }
+      if (strcmp(key, "usageMetadata") == 0 && _events->onUsage) {
+        _usage();
+        return true;
+      }
+      if (strcmp(key, "goAway") == 0) {
+        uint32_t ms = 0;
+        _members([&](const char* key) {
+          if (strcmp(key, "timeLeft") != 0) return false;
+          ms = _duration();
+          return true;
+        });
+        signals |= LIVE_GO_AWAY;
+        if (_live->onGoAway) {
+          _live->onGoAway(ms);
+        }
+        return true;
+      }
+      return false;
+    });
+    if ((signals & LIVE_INTERRUPTED) && _live->onInterrupted) {
+      _live->onInterrupted();
+    }
+    if ((signals & LIVE_TURN_COMPLETE) && _live->onTurnComplete) {
+      _live->onTurnComplete();
+    }
+    return signals;
+  }
+
+private:
+  const LiveEvents* _live = nullptr;
+
+  uint8_t _serverContent() {
+    uint8_t signals = 0;
+    _members([&](const char* key) {
+      if (strcmp(key, "modelTurn") == 0) {
+        _members([this](const char* key) {
+          if (strcmp(key, "parts") != 0) return false;
+          _elements([this] { _livePart(); });
+          return true;
+        });
+        return true;
+      }
+      if (strcmp(key, "turnComplete") == 0) {
+        signals |= _flag() ? LIVE_TURN_COMPLETE : 0;
+        return true;
+      }
+      if (strcmp(key, "interrupted") == 0) {
+        signals |= _flag() ? LIVE_INTERRUPTED : 0;
+        return true;
+      }
+      const std::function<void(char)>* transcript = strcmp(key, "inputTranscription") == 0 ? &_live->onInputTranscript
+                                                  : strcmp(key, "outputTranscription") == 0 ? &_live->onOutputTranscript : nullptr;
+      if (!transcript || !*transcript) return false;
+      _members([transcript, this](const char* key) {
+        if (strcmp(key, "text") != 0) return false;
+        getValueStream(*transcript);
+        return true;
+      });
+      return true;
+    });
+    return signals;
+  }
+
+  void _livePart() {
+    _members([this](const char* key) {
+      if (strcmp(key, "inlineData") == 0 && _live->onAudio) {
+        _members([this](const char* key) {
+          if (strcmp(key, "data") != 0) return false;
+          Base64Decoder<LIVE_AUDIO_CHUNK> decoder(_live->onAudio);
+          getValueStream([&decoder](char c) { decoder.push(c); });
+          decoder.finish();
+          _delivered++;
+          return true;
+        });
+        return true;
+      }
+      return _partMember(key);
+    });
+  }
+
+  // A JSON boolean, consumed.
+  bool _flag() {
+    _skipWhitespace();
+    bool set = _waitForData() && _stream.peek() == 't';
+    _skipValue();
+    return set;
+  }
+
+  // A protobuf Duration such as "9.5s", in ms.
+  uint32_t _duration() {
+    uint32_t ms = 0;
+    int8_t decimals = -1;
+    getValueStream([&](char c) {
+      if (c == '.') {
+        decimals = 0;
+      } else if (isdigit((uint8_t)c) && decimals < 3) {
+        ms = ms * 10 + (c - '0');
+        decimals += decimals >= 0;
+      }
+    });
+    for (int8_t i = decimals < 0 ? 0 : decimals; i < 3; i++) {
+      ms *= 10;
+    }
+    return ms;
+  }
+};
+
+class GeminiLive {
+public:
+  GeminiLive() {}
+  ~GeminiLive() {
+    end();
+  }
+
+  GeminiLive(const GeminiLive&) = delete;
+  GeminiLive& operator=(const GeminiLive&) = delete;
+
+  // The settings below are sent with the setup in begin().
+  void setModel(const String& model) {
+    _model = model;
+  }
+
+  void setModality(LiveModality modality) {
+    _modality = modality;
+  }
+
+  void setSystemInstruction(const String& instruction) {
+    _systemInstruction = instruction;
+  }
+
+  // Transcripts of the audio in both directions (onInputTranscript, onOutputTranscript).
+  void enableTranscription() {
+    _transcription = true;
+  }
+
+  void disableTranscription() {
+    _transcription = false;
+  }
+
+  // Connects, upgrades to WebSocket and sends the setup. Returns true once the server has accepted it.
+  bool begin(const String& apiKey) {
+    end();
+    if (!_payload) {
+      _payload.reset(new (std::nothrow) char[LIVE_PAYLOAD_SIZE]);
+      if (!_payload) {
+        return false;
+      }
+    }
+    bool verified = GeminiClient::secure(_client);
+    if (!GeminiClient::open(_client, verified, _connectTimeout, _tcpTimeout)) {
+      return false;
+    }
+    String path = F("/ws/google.ai.generativelanguage.v1beta.GenerativeService.BidiGenerateContent?key=");
+    path += apiKey;
+    _frames.reset();
+    if (!WebSocketHandshake::perform(_client, "generativelanguage.googleapis.com", path.c_str()) || !_sendSetup()) {
+      _client.stop();
+      return false;
+    }
+    LiveEvents none;
+    unsigned long start = millis();
+    while (millis() - start < LIVE_SETUP_TIMEOUT && connected()) {
+      if (poll(none) & LIVE_SETUP_COMPLETE) {
+        return true;
+      }
+      delay(1);
+    }
+    end();
+    return false;
+  }
+
+  // Sends a user text turn; with turnComplete the model answers it right away.
+  bool sendText(const String& text, bool turnComplete = true) {
+    if (!connected()) {
+      return false;
+    }
+    StaticJsonBuilder json(_payload.get(), LIVE_PAYLOAD_SIZE);
+    json.beginObject();
+    json.key("clientContent");
+    json.beginObject();
+    json.key("turns");
+    json.beginArray();
+    json.beginObject();
+    json.key("role");
+    json.value("user");
+    json.key("parts");
+    json.beginArray();
+    json.beginObject();
+    json.key("text");
+    json.value(text);
+    json.endObject();
+    json.endArray();
+    json.endObject();
+    json.endArray();
+    json.key("turnComplete");
+    json.value(turnComplete);
+    json.endObject();
+    json.endObject();
+    return _send(json);
+  }
+
+  // Streams 16-bit mono PCM (little-endian, as it is in memory) from the microphone. Call it for every block
+  // the microphone delivers; the server detects the end of speech itself, or call endAudio().
+  bool sendAudio(const int16_t* samples, size_t count, uint32_t sampleRate = 16000) {
+    if (!connected()) {
+      return false;
+    }
+    char* buffer = _payload.get();
+    size_t used = snprintf(buffer, LIVE_PAYLOAD_SIZE, "{\"realtimeInput\":{\"audio\":{\"mimeType\":\"audio/pcm;rate=%lu\",\"data\":\"",
+                           (unsigned long)sampleRate);
+    static const char suffix[] = "\"}}}";
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(samples);
+    size_t size = count * sizeof(int16_t);
+    WebSocketFrameWriter frame(_client, WS_TEXT, used + Base64::encodedLength(size) + sizeof(suffix) - 1);
+    // Whole groups of 3 bytes per block, so the blocks join into one base64 string.
+    while (size > 0) {
+      size_t take = std::min(size, (LIVE_PAYLOAD_SIZE - used) / 4 * 3);
+      if (take == 0) {
+        frame.writeMasked(reinterpret_cast<uint8_t*>(buffer), used);
+        used = 0;
+        continue;
+      }
+      used += Base64::encode(data, take, buffer + used);
+      data += take;
+      size -= take;
+    }
+    if (used + sizeof(suffix) - 1 > LIVE_PAYLOAD_SIZE) {
+      frame.writeMasked(reinterpret_cast<uint8_t*>(buffer), used);
+      used = 0;
+    }
+    memcpy(buffer + used, suffix, sizeof(suffix) - 1);
+    used += sizeof(suffix) - 1;
+    frame.writeMasked(reinterpret_cast<uint8_t*>(buffer), used);
+    return frame.complete();
+  }
+
+  // The microphone was turned off: the model answers what it has heard.
+  bool endAudio() {
+    if (!connected()) {
+      return false;
+    }
+    StaticJsonBuilder json(_payload.get(), LIVE_PAYLOAD_SIZE);
+    json.beginObject();
+    json.key("realtimeInput");
+    json.beginObject();
+    json.key("audioStreamEnd");
+    json.value(true);
+    json.endObject();
+    json.endObject();
+    return _send(json);
+  }
+
+  // Handles one server message if one has arrived, without waiting for one. Returns its LiveSignal bits.
+  uint8_t poll(const LiveEvents& events) {
+    if (!_frames.nextMessage() || _frames.messageEnded()) {
+      return 0;
+    }
+    LiveEventReader reader(_frames, JSON_PARSER_MAX_DEPTH, LIVE_MESSAGE_TIMEOUT);
+    return reader.read(events);
+  }
+
+  // Handles server messages until the model's turn is complete (or interrupted). False on timeout or when the
+  // session ended.
+  bool receiveTurn(const LiveEvents& events, uint32_t timeoutMs = LIVE_TURN_TIMEOUT) {
+    unsigned long start = millis();
+    while (connected() && millis() - start < timeoutMs) {
+      uint8_t signals = poll(events);
+      if (signals & (LIVE_TURN_COMPLETE | LIVE_INTERRUPTED)) {
+        return true;
+      }
+      if (signals == 0) {
+        delay(1);
+      }
+    }
+    return false;
+  }
+
+  bool connected() {
+    return _client.connected() && !_frames.closed();
+  }
+
+  // The status code the server closed the session with (e.g. 1008 for an invalid key), 0 if none.
+  uint16_t closeCode() const {
+    return _frames.closeCode();
+  }
+
+  void setTimeouts(int32_t connectTimeout, uint16_t tcpTimeout) {
+    _connectTimeout = connectTimeout;
+    _tcpTimeout = tcpTimeout;
+  }
+
+  // Closes the session (close frame, then the connection).
+  void end() {
+    if (_client.connected()) {
+      if (!_frames.closed()) {
+        _frames.close();
+      }
+      _client.stop();
+    }
+  }
+
+private:
+  SECURE_CLIENT _client;
+  WebSocketFrameStream _frames{_client};
+  std::unique_ptr<char[]> _payload;
+  String _model = GEMINI_LIVE_MODEL;
+  String _systemInstruction;
+  LiveModality _modality = LIVE_TEXT;
+  bool _transcription = false;
+  int32_t _connectTimeout = 10000;
+  uint16_t _tcpTimeout = 5000;
+
+  bool _sendSetup() {
+    StaticJsonBuilder json(_payload.get(), LIVE_PAYLOAD_SIZE);
+    json.beginObject();
+    json.key("setup");
+    json.beginObject();
+    json.key("model");
+    json.beginString();
+    json.appendString("models/");
+    json.appendString(_model);
+    json.endString();
+    json.key("generationConfig");
+    json.beginObject();
+    json.key("responseModalities");
+    json.beginArray();
+    json.value(_modality == LIVE_AUDIO ? "AUDIO" : "TEXT");
+    json.endArray();
+    json.endObject();
+    if (_systemInstruction.length() > 0) {
+      json.key("systemInstruction");
+      json.beginObject();
+      json.key("parts");
+      json.beginArray();
+      json.beginObject();
+      json.key("text");
+      json.value(_systemInstruction);
+      json.endObject();
+      json.endArray();
+      json.endObject();
+    }
+    if (_transcription) {
+      json.key("inputAudioTranscription");
+      json.beginObject();
+      json.endObject();
+      json.key("outputAudioTranscription");
+      json.beginObject();
+      json.endObject();
+    }
+    json.endObject();
+    json.endObject();
+    return _send(json);
+  }
+
+  // Sends the built message, masking it in place.
+  bool _send(StaticJsonBuilder& json) {
+    if (json.overflowed()) {
+      return false;
+    }
+    WebSocketFrameWriter frame(_client, WS_TEXT, json.size());
+    frame.writeMasked(reinterpret_cast<uint8_t*>(_payload.get()), json.size());
+    return frame.complete();
+  }
+};
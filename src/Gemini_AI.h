@@ -40,12 +40,57 @@
     #define PAYLOAD_BUFFER_SIZE 2048
   #endif
 
-  #if defined(ESP8266)
-    #define MAX_TOKENS 1000 
-    #define DEFAULT_TOKENS 500 
-  #elif defined(ESP32)
-    #define MAX_TOKENS 5000
-    #define DEFAULT_TOKENS 3000
+  // gzip needs a history window (GZIP_WINDOW_SIZE) per request, so it is opt-in on ESP8266.
+  #ifndef GEMINI_GZIP_DEFAULT
+    #if defined(ESP8266)
+      #define GEMINI_GZIP_DEFAULT false
+    #else
+      #define GEMINI_GZIP_DEFAULT true
+    #endif
+  #endif
+
+  // Per-request scratch memory, allocated once: payload + header + answer (+ gzip window when compression is on).
+  #ifndef GEMINI_ARENA_SIZE
+    #if defined(ESP8266)
+      #define GEMINI_ARENA_SIZE 4096
+    #elif defined(ESP32)
+      #define GEMINI_ARENA_SIZE (8192 + GZIP_WINDOW_SIZE)
+    #endif
+  #endif
+
+  // maxOutputTokens is chosen per request: answers returned as a String get what fits in memory, streamed
+  // answers are unlimited. DEFAULT_TOKENS sets a fixed limit instead (same as setMaxTokens()), MAX_TOKENS a
+  // ceiling no request may exceed, not even through setMaxTokens(). 0 = none.
+  #ifndef MAX_TOKENS
+    #define MAX_TOKENS 0
+  #endif
+  #ifndef DEFAULT_TOKENS
+    #define DEFAULT_TOKENS 0
+  #endif
+
+  // Free heap left untouched when sizing an answer that is returned as a String (TLS buffers, the sketch).
+  #ifndef GEMINI_HEAP_RESERVE
+    #if defined(ESP8266)
+      #define GEMINI_HEAP_RESERVE 8192
+    #elif defined(ESP32)
+      #define GEMINI_HEAP_RESERVE 40960
+    #endif
+  #endif
+
+  // Idle time after which a kept-alive connection is closed, when prewarm() turns keep-alive on (ms).
+  #ifndef GEMINI_KEEPALIVE_IDLE
+    #define GEMINI_KEEPALIVE_IDLE 60000
+  #endif
+
+  // Minimum time between two attempts of automatic prewarming to open a connection (ms).
+  #ifndef GEMINI_PREWARM_INTERVAL
+    #define GEMINI_PREWARM_INTERVAL 10000
+  #endif
+
+  // Longest time a context cache is left alone before it is extended (s). millis() deadlines only compare
+  // correctly up to 24.8 days ahead, so caches with a longer TTL are extended earlier, which does no harm.
+  #ifndef GEMINI_CACHE_RENEW_MAX
+    #define GEMINI_CACHE_RENEW_MAX (20UL * 24 * 3600)
   #endif
 
   #ifdef DEBUG
@@ -60,19 +105,101 @@
     #define debuglnF(x)
   #endif
   
+  #include <climits>
+  #include <memory>
+  #include <type_traits>
   #include "GeminiClient.hpp"
   #include "StreamJsonParser.hpp"
   #include "StaticJsonBuilder.hpp"
+  #include "RequestArena.hpp"
+  #include "EmbeddingIndex.hpp"
+  #include "BatchAnswerDemux.hpp"
+  #include "RequestCoalescer.hpp"
+  #include "SpeechFilter.hpp"
+  #include "ResponseEvents.hpp"
+  #include "TokenEstimator.hpp"
+  #include "ClientPool.hpp"
+  #include "OutputBuffer.hpp"
+  #include "GeminiLive.hpp"
+
+  #if defined(ESP32)
+    #include <mutex>
+  #endif
+
+  struct BatchItemStats {
+    unsigned long firstCharMs = 0;
+    unsigned long totalMs = 0;
+    size_t length = 0;
+  };
+
+  struct TokenUsage {
+    uint32_t promptEstimate = 0; // Local estimate before sending.
+    uint32_t promptTokens = 0;   // From the response's usageMetadata.
+    uint32_t answerTokens = 0;
+    int maxOutputTokens = 0;     // Limit sent with the request (0 = none).
+  };
+
+  // Connection setup that kept-alive and prewarmed connections saved.
+  struct ConnectionStats {
+    uint32_t coldConnects = 0;   // Connections opened, by requests or prewarming.
+    uint32_t warmRequests = 0;   // Requests sent on a connection that was already open.
+    uint32_t connectMs = 0;      // Average time to open a connection (DNS, TCP, TLS).
+    uint32_t lastSavedMs = 0;    // Saved by the last request, 0 if it had to open its connection.
+    uint32_t savedMs = 0;        // Saved by all warm requests.
+    uint32_t dnsHits = 0;        // Connections opened without a DNS query (ESP32).
+  };
+
+  // Compile-time configuration of BasicGemini. Features switched off here are removed from the build
+  // (payload code, float formatting, gzip negotiation, ...). Derive from it and override what you need:
+  //
+  //   struct TinyGeminiPolicy : DefaultGeminiPolicy {
+  //     static constexpr size_t payloadBufferSize = 768;
+  //     static constexpr bool tools = false;
+  //     static constexpr bool sampling = false;
+  //   };
+  //   BasicGemini<TinyGeminiPolicy> ai;
+  struct DefaultGeminiPolicy {
+    static constexpr size_t payloadBufferSize = PAYLOAD_BUFFER_SIZE;
+    static constexpr size_t arenaSize = GEMINI_ARENA_SIZE;
+    static constexpr int maxTokens = MAX_TOKENS;
+    static constexpr int defaultTokens = DEFAULT_TOKENS;
+    static constexpr int jsonMaxDepth = JSON_MAX_DEPTH;
+    // Limits applied while reading a response (see StreamJsonParser.hpp).
+    static constexpr uint8_t responseMaxDepth = JSON_PARSER_MAX_DEPTH;
+    static constexpr uint32_t responseIdleTimeout = JSON_PARSER_IDLE_TIMEOUT;
+    static constexpr uint32_t responseTotalTimeout = JSON_PARSER_TOTAL_TIMEOUT;
 
-  class Gemini_AI {
+    static constexpr bool tools = true;           // Code execution and Google Search.
+    static constexpr bool sampling = true;        // Temperature, topP and topK.
+    static constexpr bool imageGeneration = true; // Image output for "*image-generation" models.
+    static constexpr bool batch = true;           // getAnswers()/getAnswersStream().
+    static constexpr bool caching = true;         // createCache() and friends.
+    static constexpr bool coalescing = true;      // enableRequestCoalescing() (ESP32).
+    static constexpr bool pooling = true;         // enableConnectionPool() (ESP32).
+    static constexpr bool compression = true;     // gzip responses.
+    static constexpr bool markdownFilter = true;  // Plain-text answers and sentences (see SpeechFilter.hpp).
+
+    // Anything with GeminiClient's interface.
+    typedef GeminiClient Transport;
+    // Return type of getAnswer(), constructible from a String (or from a const char*).
+    typedef String Output;
+  };
+
+  template <typename Policy>
+  class BasicGemini {
   
     private:
 
+      typedef typename Policy::Transport Transport;
+      typedef typename Policy::Output Output;
+      typedef BasicStaticJsonBuilder<Policy::jsonMaxDepth> JsonBuilder;
+
       const char* model = "gemini-2.5-flash-lite";
+      const char* embeddingModel = "gemini-embedding-001";
       const char* systemInstruction = "You are a highly intelligent AI assistant. Use emojis and symbols where relevant.";
       const char* apiKey = nullptr;
       
-      int maxTokens = DEFAULT_TOKENS;
+      int maxTokens = Policy::defaultTokens;
     
       float temperature = 0;
       float TopP = 0;
@@ -80,94 +207,290 @@
     
       bool codeExecution = false;
       bool googleSearch = false;
+      bool coalescing = false;
+      bool compression = Policy::compression && GEMINI_GZIP_DEFAULT;
+      bool markdownFilter = false;
+
+      String cacheName;
+      const char* cacheDocument = nullptr;
+      uint32_t cacheTtl = 0;
+      unsigned long cacheExpiresAt = 0;
+      bool cacheRenewing = false;
 
-      String _escape(const String& s) {
-        int outlength = s.length() + (s.length() / 10);
-        String out;
-        if (!out.reserve(outlength)) {
-          debugln("Failed to reserve" + String(outlength) + "b while escaping special charecters!");
-        }
-        for (char c: s) {
-          switch (c) {
-            case '\"': out.concat(F("\\\"")); break;
-            case '\\': out.concat(F("\\\\")); break;
-            case '\b': out.concat(F("\\b")); break;
-            case '\f': out.concat(F("\\f")); break;
-            case '\n': out.concat(F("\\n")); break;
-            case '\r': out.concat(F("\\r")); break;
-            case '\t': out.concat(F("\\t")); break;
-            default: out += c; break;
+      RequestArena arena;
+
+      TokenEstimator estimator;
+      TokenUsage usage;
+      int maxPromptTokens = 0;
+
+      // Kept-alive connection of requests outside the pool, see setKeepAlive() and prewarm().
+      Transport connection;
+      uint32_t keepAliveIdle = 0;
+      unsigned long connectionUsed = 0;
+      size_t autoPrewarm = 0;
+      unsigned long lastPrewarm = 0;
+      ConnectionStats connectionStats;
+
+      #if defined(ESP32)
+        std::unique_ptr<ClientPool<Transport>> pool;
+        std::mutex statsMutex;
+      #endif
+
+      // Guards the estimator, the last usage and the cache state, which requests on pool connections share.
+      class StatsLock {
+        public:
+          #if defined(ESP32)
+            explicit StatsLock(BasicGemini& gemini) : guard(gemini.statsMutex) {}
+          private:
+            std::lock_guard<std::mutex> guard;
+          #else
+            explicit StatsLock(BasicGemini&) {}
+          #endif
+      };
+
+      // The arena of a request that doesn't go through _generate(). While the pool is enabled it is a pool slot's,
+      // so it is never shared with a request on another task; otherwise it is the instance arena.
+      class ArenaLease {
+        public:
+          explicit ArenaLease(BasicGemini& gemini) : target(&gemini.arena) {
+            #if defined(ESP32)
+              if (gemini.pool) {
+                pool = gemini.pool.get();
+                slot = pool->checkout(Policy::responseTotalTimeout);
+                target = slot ? &slot->arena : nullptr;
+                if (!slot) {
+                  debuglnF("No free connection in the pool!");
+                }
+              }
+            #endif
+          }
+
+          ~ArenaLease() {
+            #if defined(ESP32)
+              if (slot) pool->release(slot);
+            #endif
+          }
+
+          ArenaLease(const ArenaLease&) = delete;
+          ArenaLease& operator=(const ArenaLease&) = delete;
+
+          // nullptr if no pool slot became free in time.
+          RequestArena* get() {
+            return target;
           }
+
+        private:
+          RequestArena* target;
+          #if defined(ESP32)
+            ClientPool<Transport>* pool = nullptr;
+            typename ClientPool<Transport>::Slot* slot = nullptr;
+          #endif
+      };
+
+      // What one generateContent request works with. Requests on pool connections each bring their own arena
+      // and client, so they share nothing with each other.
+      struct Request {
+        RequestArena& arena;
+        Transport& client;
+        TokenUsage usage;
+        uint32_t promptUnits;
+        size_t answerBytes;
+      };
+
+      Print* capture = nullptr;
+      ReplayStream* replay = nullptr;
+
+      bool _ensureArena() {
+        if (arena.capacity() == 0 && !arena.begin(Policy::arenaSize)) {
+          debuglnF("Failed to allocate request arena!");
+          return false;
         }
-        return out;
+        return true;
       }
 
-      String _buildGeminiPayload(const String& question) {
-        int maxtokens = std::min(maxTokens, MAX_TOKENS);
-        char payload[PAYLOAD_BUFFER_SIZE];
-        StaticJsonBuilder builder(payload, PAYLOAD_BUFFER_SIZE, false);
+      char* _payloadBuffer(RequestArena& target) {
+        char* payload = (&target != &arena || _ensureArena()) ? (char*)target.allocate(Policy::payloadBufferSize, 1) : nullptr;
+        if (!payload) {
+          debuglnF("No room for the payload in the request arena!");
+        }
+        return payload;
+      }
+
+      void _writeBatchPrompt(JsonBuilder& builder, const String* questions, size_t count) {
+        char number[16];
+        builder.beginString();
+        snprintf(number, sizeof(number), "%u", (unsigned)count);
+        builder.appendString("Answer each of the following ");
+        builder.appendString(number);
+        builder.appendString(" questions independently. Reply with a JSON array of exactly ");
+        builder.appendString(number);
+        builder.appendString(" strings, where element i is the answer to question i.\n");
+        for (size_t i = 0; i < count; i++) {
+          snprintf(number, sizeof(number), "%u. ", (unsigned)(i + 1));
+          builder.appendString(number);
+          builder.appendString(questions[i]);
+          builder.appendString("\n");
+        }
+        builder.endString();
+      }
+
+      // Largest free heap block minus GEMINI_HEAP_RESERVE.
+      static size_t _heapBudget() {
+        #if defined(ESP8266)
+          size_t block = ESP.getMaxFreeBlockSize();
+        #else
+          size_t block = ESP.getMaxAllocHeap();
+        #endif
+        return block > GEMINI_HEAP_RESERVE ? block - GEMINI_HEAP_RESERVE : 0;
+      }
+
+      // Output tokens whose answer still fits in the arena (after header and gzip window) plus the free heap.
+      int _affordableTokens(RequestArena& requestArena) {
+        size_t used = HEADER_BUFFER_SIZE + 64;
+        if (Policy::compression && compression) {
+          used += GZIP_WINDOW_SIZE;
+        }
+        size_t bytes = (requestArena.capacity() > used ? requestArena.capacity() - used : 0) + _heapBudget();
+        StatsLock lock(*this);
+        return (int)std::max<uint32_t>(std::min<uint32_t>(estimator.tokensFor(bytes), INT_MAX), 16);
+      }
+
+      // batchCount == 0 builds a normal request for questions[0], otherwise a structured batch request.
+      // `buffered` answers are returned as a String, so maxOutputTokens is also limited by free memory.
+      const char* _buildGeminiPayload(Request& request, const String* questions, size_t batchCount, bool buffered) {
+        if (!Policy::batch) {
+          batchCount = 0;
+        }
+        int maxtokens = maxTokens;
+        if (batchCount > 1 && maxtokens != 0) {
+          maxtokens = (int)std::min((long)maxtokens * (long)batchCount, (long)INT_MAX);
+        }
+        if (buffered) {
+          int affordable = _affordableTokens(request.arena);
+          maxtokens = maxtokens == 0 ? affordable : std::min(maxtokens, affordable);
+        }
+        if (Policy::maxTokens > 0) {
+          maxtokens = maxtokens == 0 ? Policy::maxTokens : std::min(maxtokens, Policy::maxTokens);
+        }
+        bool imageGeneration = false;
+        if constexpr (Policy::imageGeneration) {
+          imageGeneration = batchCount == 0 && strstr(model, "image-generation") != nullptr;
+        }
+        String cache;
+        if constexpr (Policy::caching) {
+          StatsLock lock(*this);
+          cache = cacheName;
+        }
+        bool cached = cache.length() > 0;
+        uint32_t units = TokenEstimator::weigh(systemInstruction);
+        for (size_t i = 0; i < std::max(batchCount, (size_t)1); i++) {
+          units += TokenEstimator::weigh(questions[i].c_str(), questions[i].length());
+        }
+        {
+          StatsLock lock(*this);
+          request.usage.promptEstimate = estimator.tokens(units);
+        }
+        request.usage.maxOutputTokens = maxtokens;
+        // Only plain requests calibrate the estimator: cached content, tools and batch prompts add tokens it doesn't see.
+        bool tools = Policy::tools && (googleSearch || codeExecution);
+        request.promptUnits = (cached || tools || batchCount > 0) ? 0 : units;
+        if (maxPromptTokens > 0 && request.usage.promptEstimate > (uint32_t)maxPromptTokens) {
+          debugln("Prompt of ~" + String(request.usage.promptEstimate) + " tokens exceeds the limit, not sent.");
+          return nullptr;
+        }
+        char* payload = _payloadBuffer(request.arena);
+        if (!payload) {
+          return nullptr;
+        }
+        JsonBuilder builder(payload, Policy::payloadBufferSize, false);
         builder.beginObject();
-        if (googleSearch || codeExecution) {
-          builder.key("tools");
-          builder.beginArray();
-          builder.beginObject();
-          if (googleSearch && codeExecution) {
-            builder.key("googleSearch");
-            builder.beginObject();
-            builder.endObject();
-            builder.key("codeExecution");
+        if (cached) {
+          builder.key("cachedContent");
+          builder.value(cache);
+        } else if constexpr (Policy::tools) {
+          if (batchCount == 0 && (googleSearch || codeExecution)) {
+            builder.key("tools");
+            builder.beginArray();
             builder.beginObject();
-            builder.endObject();
-          } else {
-            if (googleSearch) {
+            if (googleSearch && codeExecution) {
               builder.key("googleSearch");
               builder.beginObject();
               builder.endObject();
-            } else if (codeExecution) {
               builder.key("codeExecution");
               builder.beginObject();
               builder.endObject();
+            } else {
+              if (googleSearch) {
+                builder.key("googleSearch");
+                builder.beginObject();
+                builder.endObject();
+              } else if (codeExecution) {
+                builder.key("codeExecution");
+                builder.beginObject();
+                builder.endObject();
+              }
             }
+            builder.endObject();
+            builder.endArray();
           }
-          builder.endObject();
-          builder.endArray();
         }
-        if (temperature != 0 || TopP != 0 || TopK != 0 || maxtokens != 0 || strstr(model, "image-generation") != nullptr) {
+        bool sampled = Policy::sampling && (temperature != 0 || TopP != 0 || TopK != 0);
+        if (sampled || maxtokens != 0 || imageGeneration || batchCount > 0) {
           builder.key("generationConfig");
           builder.beginObject();
-          if (temperature != 0) {
-            builder.key("temperature");
-            builder.value(temperature);
-          }
-          if (TopP != 0) {
-            builder.key("topP");
-            builder.value(TopP);
-          }
-          if (TopK != 0) {
-            builder.key("topK");
-            builder.value(TopK);
+          if constexpr (Policy::sampling) {
+            if (temperature != 0) {
+              builder.key("temperature");
+              builder.value(temperature);
+            }
+            if (TopP != 0) {
+              builder.key("topP");
+              builder.value(TopP);
+            }
+            if (TopK != 0) {
+              builder.key("topK");
+              builder.value(TopK);
+            }
           }
           if (maxtokens != 0) {
             builder.key("maxOutputTokens");
             builder.value(maxtokens);
           }
-          if (strstr(model, "image-generation") != nullptr) {
+          if (Policy::imageGeneration && imageGeneration) {
             builder.key("responseModalities");
             builder.beginArray();
             builder.value("IMAGE");
             builder.value("TEXT");
             builder.endArray();
           }
+          if (Policy::batch && batchCount > 0) {
+            builder.key("responseMimeType");
+            builder.value("application/json");
+            builder.key("responseSchema");
+            builder.beginObject();
+            builder.key("type");
+            builder.value("ARRAY");
+            builder.key("items");
+            builder.beginObject();
+            builder.key("type");
+            builder.value("STRING");
+            builder.endObject();
+            builder.key("minItems");
+            builder.value((int)batchCount);
+            builder.key("maxItems");
+            builder.value((int)batchCount);
+            builder.endObject();
+          }
           builder.endObject();
         }
-        if (systemInstruction && strlen(systemInstruction) > 0) {
+        if (!cached && systemInstruction && strlen(systemInstruction) > 0) {
           builder.key("systemInstruction");
           builder.beginObject();
           builder.key("parts");
           builder.beginArray();
           builder.beginObject();
           builder.key("text");
-          builder.value(_escape(String(systemInstruction) + "Give *FULL* answer carefully without mistakes. Don't mention you can't use '*'"));
+          builder.value(systemInstruction);
           builder.endObject();
           builder.endArray();
           builder.endObject();
@@ -181,68 +504,174 @@
         builder.beginArray();
         builder.beginObject();
         builder.key("text");
-        builder.value(_escape(question));
+        if (Policy::batch && batchCount > 0) {
+          _writeBatchPrompt(builder, questions, batchCount);
+        } else {
+          builder.value(questions[0]);
+        }
         builder.endObject();
         builder.endArray();
         builder.endObject();
         builder.endArray();
         builder.endObject();
-        return String(payload);
+        if (builder.overflowed()) {
+          debuglnF("Payload too large, not sent. Increase the payload buffer (Policy::payloadBufferSize)!");
+          return nullptr;
+        }
+        return payload;
       }
     
-      String _sendRequest(const String& question, std::function < void(char) > onChar = nullptr) {
-        if (WiFi.status() != WL_CONNECTED) {
+      // A replay needs no network.
+      bool _online() {
+        return replay || WiFi.status() == WL_CONNECTED;
+      }
+
+      StreamJsonParser _parser(Stream& stream) {
+        return StreamJsonParser(stream, Policy::responseMaxDepth, Policy::responseIdleTimeout, Policy::responseTotalTimeout);
+      }
+
+      bool _beginClient(Transport& client, const char* modelName, RequestArena* requestArena = nullptr) {
+        if (!client.begin(String(modelName), String(apiKey))) {
+          return false;
+        }
+        client.setAcceptGzip(Policy::compression && compression);
+        client.setResponseTimeouts(Policy::responseIdleTimeout, Policy::responseTotalTimeout);
+        client.setArena(requestArena ? requestArena : &arena);
+        client.setCapture(capture);
+        client.setReplay(replay);
+        return true;
+      }
+
+      // `plain` passes the answer text through the MarkdownStripper. `events` subscribes to the other parts of
+      // the response too; its text goes to `onChar`, and without its own onText the text is skipped.
+      String _sendRequest(Request& request, const char* payload, std::function < void(char) > onChar, bool plain, const ResponseEvents* events) {
+        RequestArena& arena = request.arena;
+        Transport& client = request.client;
+        RequestArena::Scope scope(arena);
+        if (!payload) {
+          return "";
+        }
+        if (!_online()) {
           debuglnF("WiFi not connected!");
           return "";
         }
-        GeminiClient client;
-        if (!client.begin(String(model), String(apiKey))) {
+        if (!_beginClient(client, model, &arena)) {
           client.end();
           debuglnF("GeminiClient Begin Failed.");
           return "";
         }
-        int httpcode = client.POST(_buildGeminiPayload(question));
+        int httpcode = client.POST(payload, strlen(payload));
+        // Payload and header are on the wire, their arena space is reused for the response.
+        arena.reset();
         if (httpcode > 0) {
           if (httpcode == 200 || httpcode == 301) {
-            StreamJsonParser parser(client.getStream());
-            if (parser.find("text")) {
-              String result;
-              #if defined(ESP8266)
-                if (!result.reserve(512)) {
-                  debugF("Failed to reserve 512 bytes for result.!\nFree Heap: ");
-              #elif defined(ESP32)
-                if (!result.reserve(4096)) {
-                  debugF("Failed to reserve 4kbs for result.!\nFree Heap: ");  
-              #endif
-                debugln(ESP.getFreeHeap());
-                client.end();
-                return "";
+            // The body decoders come from the arena too, so they must exist before the answer takes its tail.
+            Stream& body = client.getBodyStream();
+            // If the decoders used up the arena there is no byte left for the terminator, the answer goes to the heap.
+            char* answer = arena.remaining() > 0 ? arena.tail() : nullptr;
+            size_t length = 0;
+            size_t texts = 0;
+            size_t textBytes = 0;
+            String overflow;
+            size_t reserved = 0;
+            bool truncated = false;
+            auto deliver = [&](char c) {
+              if (onChar) {
+                onChar(c);
+              } else if (answer && overflow.length() == 0 && arena.remaining() > 1) {
+                answer[length++] = c;
+                arena.commit(1);
+              } else if (!truncated) {
+                // Grow geometrically, but never into GEMINI_HEAP_RESERVE.
+                if (overflow.length() == reserved) {
+                  size_t want = std::min(std::max(reserved * 2, (size_t)512), _heapBudget());
+                  if (want <= reserved || !overflow.reserve(want)) {
+                    truncated = true;
+                    return;
+                  }
+                  reserved = want;
+                }
+                overflow += c;
               }
-              parser.getValueStream([&result, &onChar](char c) {
-                if (onChar) {
-                  onChar(c);
-                } else {
-                  result += c;
+            };
+            MarkdownStripper stripper(deliver);
+            ResponseEvents handlers;
+            if (events) {
+              handlers = *events;
+            }
+            if (!events || events->onText) {
+              handlers.onText = [&](char c) {
+                textBytes++;
+                if constexpr (Policy::markdownFilter) {
+                  if (plain) {
+                    stripper.push(c);
+                    return;
+                  }
                 }
-                delay(1);
-              });
-              client.end();
-              return result;
-            } else {
+                deliver(c);
+              };
+            }
+            handlers.onPartEnd = [&](ResponsePart part) {
+              if (part == PART_TEXT) {
+                texts++;
+                if constexpr (Policy::markdownFilter) {
+                  if (plain) {
+                    stripper.finish();
+                    stripper.reset();
+                  }
+                }
+              }
+              if (events && events->onPartEnd) {
+                events->onPartEnd(part);
+              }
+            };
+            handlers.onUsage = [&](uint32_t prompt, uint32_t answer) {
+              request.usage.promptTokens = prompt;
+              request.usage.answerTokens = answer;
+              if (events && events->onUsage) {
+                events->onUsage(prompt, answer);
+              }
+            };
+            ResponseEventReader reader(body, Policy::responseMaxDepth, Policy::responseIdleTimeout, Policy::responseTotalTimeout);
+            reader.read(handlers);
+            request.answerBytes = textBytes;
+            client.end();
+            if (reader.timedOut()) {
+              debuglnF("Response stalled, the answer is incomplete.");
+            }
+            if (truncated) {
+              debuglnF("Out of memory, the answer is truncated.");
+            }
+            if (texts == 0 && handlers.onText) {
               debuglnF("Couldn't find answer(\"text\") in response!");
-              client.end();
               return "";
             }
+            if (onChar || events) {
+              return "";
+            }
+            String result;
+            if (answer) {
+              answer[length] = '\0';
+              result = answer;
+            }
+            if (overflow.length() > 0) {
+              debuglnF("Answer larger than the request arena, continued on the heap.");
+              result += overflow;
+            }
+            return result;
           } else {
-            WiFiClient &stream = client.getStream();
+            Stream &stream = client.getBodyStream();
             debuglnF("ERROR : \n");
-            while (client.connected() || stream.available()) {
+            unsigned long start = millis();
+            while (!client.bodyEnded() && (client.connected() || stream.available()) && millis() - start < Policy::responseTotalTimeout) {
               if (stream.available()) {
                 Serial.write(stream.read());
+              } else {
+                delay(50);
               }
-              delay(50);
             }
             debugln();
+            client.end();
             return "";
           }
         } else {
@@ -252,12 +681,291 @@
         }
       }
 
+      // Builds and sends one generateContent request, on a pool connection when the pool is enabled.
+      String _generate(const String* questions, size_t batchCount, bool buffered, std::function < void(char) > onChar,
+                       bool plain = false, const ResponseEvents* events = nullptr) {
+        #if defined(ESP32)
+          if (pool) {
+            typename ClientPool<Transport>::Slot* slot = pool->checkout(Policy::responseTotalTimeout);
+            if (!slot) {
+              debuglnF("No free connection in the pool!");
+              return "";
+            }
+            String result = _generateOn(slot->arena, slot->client, questions, batchCount, buffered, onChar, plain, events);
+            pool->release(slot);
+            return result;
+          }
+        #endif
+        if (keepAliveIdle > 0) {
+          _expireConnection();
+          String result = _generateOn(arena, connection, questions, batchCount, buffered, onChar, plain, events);
+          connectionUsed = millis();
+          return result;
+        }
+        Transport client;
+        return _generateOn(arena, client, questions, batchCount, buffered, onChar, plain, events);
+      }
+
+      String _generateOn(RequestArena& requestArena, Transport& client, const String* questions, size_t batchCount, bool buffered,
+                         std::function < void(char) > onChar, bool plain, const ResponseEvents* events) {
+        Request request{requestArena, client, TokenUsage(), 0, 0};
+        String result = _sendRequest(request, _buildGeminiPayload(request, questions, batchCount, buffered), onChar, plain, events);
+        _recordUsage(request);
+        return result;
+      }
+
+      void _recordUsage(const Request& request) {
+        StatsLock lock(*this);
+        if (request.promptUnits > 0 && request.usage.promptTokens > 0) {
+          estimator.calibrate(request.promptUnits, request.usage.promptTokens);
+          estimator.calibrateOutput(request.answerBytes, request.usage.answerTokens);
+        }
+        usage = request.usage;
+        connectionStats.lastSavedMs = 0;
+        if (request.client.connectTime() > 0) {
+          _recordConnect(request.client.connectTime());
+        } else if (request.client.warm()) {
+          connectionStats.warmRequests++;
+          connectionStats.lastSavedMs = connectionStats.connectMs;
+          connectionStats.savedMs += connectionStats.connectMs;
+          debugln("Warm connection, saved ~" + String(connectionStats.connectMs) + " ms.");
+        }
+      }
+
+      // With the stats lock held.
+      void _recordConnect(uint32_t ms) {
+        connectionStats.coldConnects++;
+        connectionStats.connectMs = connectionStats.connectMs ? (3 * connectionStats.connectMs + ms) / 4 : ms;
+      }
+
+      // Closes the kept-alive connection when it has been idle too long or the server has closed it.
+      void _expireConnection() {
+        if (millis() - connectionUsed > keepAliveIdle || !connection.healthy()) {
+          connection.close();
+        }
+      }
+
+      bool _openConnection(Transport& client, RequestArena* requestArena) {
+        if (replay || !_beginClient(client, model, requestArena) || !client.prewarm()) {
+          debuglnF("Prewarming failed.");
+          return false;
+        }
+        StatsLock lock(*this);
+        _recordConnect(client.connectTime());
+        return true;
+      }
+
+      const char* _buildEmbedPayload(RequestArena& requestArena, const String* texts, size_t count, size_t dims) {
+        char* payload = _payloadBuffer(requestArena);
+        if (!payload) {
+          return nullptr;
+        }
+        String modelName = String("models/") + embeddingModel;
+        JsonBuilder builder(payload, Policy::payloadBufferSize, false);
+        builder.beginObject();
+        if (count > 1) {
+          builder.key("requests");
+          builder.beginArray();
+        }
+        for (size_t i = 0; i < count; i++) {
+          if (count > 1) {
+            builder.beginObject();
+          }
+          builder.key("model");
+          builder.value(modelName);
+          builder.key("content");
+          builder.beginObject();
+          builder.key("parts");
+          builder.beginArray();
+          builder.beginObject();
+          builder.key("text");
+          builder.value(texts[i]);
+          builder.endObject();
+          builder.endArray();
+          builder.endObject();
+          builder.key("outputDimensionality");
+          builder.value((int)dims);
+          if (count > 1) {
+            builder.endObject();
+          }
+        }
+        if (count > 1) {
+          builder.endArray();
+        }
+        builder.endObject();
+        if (builder.overflowed()) {
+          debuglnF("Payload too large, not sent. Increase the payload buffer (Policy::payloadBufferSize)!");
+          return nullptr;
+        }
+        return payload;
+      }
+
+      size_t _sendEmbedRequest(const String* texts, size_t count, int8_t* out, size_t dims, float* invNorms) {
+        if (!_online()) {
+          debuglnF("WiFi not connected!");
+          return 0;
+        }
+        ArenaLease lease(*this);
+        if (!lease.get()) {
+          return 0;
+        }
+        RequestArena& arena = *lease.get();
+        RequestArena::Scope scope(arena);
+        Transport client;
+        if (!_beginClient(client, embeddingModel, &arena)) {
+          client.end();
+          debuglnF("GeminiClient Begin Failed.");
+          return 0;
+        }
+        client.setAction(count > 1 ? "batchEmbedContents" : "embedContent");
+        const char* payload = _buildEmbedPayload(arena, texts, count, dims);
+        if (!payload) {
+          return 0;
+        }
+        int httpcode = client.POST(payload, strlen(payload));
+        arena.reset();
+        if (httpcode != 200) {
+          client.end();
+          debugln("Embedding request failed: " + String(httpcode) + ", " + client.errorToString(httpcode));
+          return 0;
+        }
+        StreamJsonParser parser = _parser(client.getBodyStream());
+        size_t done = 0;
+        while (done < count && parser.find("values")) {
+          EmbeddingQuantizer quantizer(out + done * dims, dims);
+          parser.getFloatArray([&quantizer](float v) {
+            quantizer.push(v);
+          });
+          if (quantizer.count() != dims) {
+            debugln("Expected " + String((int)dims) + " values, got " + String((int)quantizer.count()));
+          }
+          quantizer.finish();
+          if (invNorms) {
+            invNorms[done] = quantizer.invNorm();
+          }
+          done++;
+        }
+        client.end();
+        return done;
+      }
+
+      static size_t _writeEscaped(Print* out, const char* s) {
+        if (!out) {
+          return JsonStringEncoder::measure(s);
+        }
+        JsonPrintSink sink{*out};
+        return JsonStringEncoder::encode(sink, s);
+      }
+
+      // Writes the cachedContents body to `out`, or only measures it when `out` is nullptr.
+      size_t _writeCacheBody(Print* out, const char* document, uint32_t ttlSeconds) {
+        size_t size = 0;
+        auto raw = [&](const char* text) {
+          size_t n = strlen(text);
+          if (out) out->write((const uint8_t*)text, n);
+          size += n;
+        };
+        raw("{\"model\":\"models/");
+        raw(model);
+        raw("\",\"ttl\":\"");
+        raw(String(ttlSeconds).c_str());
+        raw("s\"");
+        if (systemInstruction && strlen(systemInstruction) > 0) {
+          raw(",\"systemInstruction\":{\"parts\":[{\"text\":\"");
+          size += _writeEscaped(out, systemInstruction);
+          raw("\"}]}");
+        }
+        if (document && strlen(document) > 0) {
+          raw(",\"contents\":[{\"role\":\"user\",\"parts\":[{\"text\":\"");
+          size += _writeEscaped(out, document);
+          raw("\"}]}]");
+        }
+        if (Policy::tools && (googleSearch || codeExecution)) {
+          raw(",\"tools\":[{");
+          if (googleSearch) raw("\"googleSearch\":{}");
+          if (googleSearch && codeExecution) raw(",");
+          if (codeExecution) raw("\"codeExecution\":{}");
+          raw("}]");
+        }
+        raw("}");
+        return size;
+      }
+
+      // When the cache has to be extended, in millis(), with the TTL capped to GEMINI_CACHE_RENEW_MAX (on 32 bits,
+      // ttl * 1000 would wrap after 49.7 days).
+      static unsigned long _cacheDeadline(uint32_t ttlSeconds) {
+        return millis() + std::min<uint32_t>(ttlSeconds, GEMINI_CACHE_RENEW_MAX) * 1000UL;
+      }
+
+      // Keeps the context cache alive: extends it shortly before it expires, recreates it if it is gone.
+      // Only one task renews it; the others go on with the current name, which is still valid for the margin.
+      void _ensureCache() {
+        if constexpr (Policy::caching) {
+          const char* document;
+          uint32_t ttl;
+          {
+            StatsLock lock(*this);
+            if (cacheName.length() == 0 || cacheRenewing) {
+              return;
+            }
+            uint32_t margin = std::min<uint32_t>(60, std::min<uint32_t>(cacheTtl, GEMINI_CACHE_RENEW_MAX) / 4) * 1000UL;
+            if ((long)(cacheExpiresAt - millis()) > (long)margin) {
+              return;
+            }
+            cacheRenewing = true;
+            document = cacheDocument;
+            ttl = cacheTtl;
+          }
+          if (!refreshCache()) {
+            debuglnF("Cache refresh failed, recreating it.");
+            {
+              StatsLock lock(*this);
+              cacheName = "";
+            }
+            createCache(document, ttl);
+          }
+          StatsLock lock(*this);
+          cacheRenewing = false;
+        }
+      }
+
+      RequestKey _requestKey(const String& question, bool plain) {
+        RequestKey key;
+        key.add(model).add(systemInstruction).add(apiKey);
+        key.add(&maxTokens, sizeof(maxTokens)).add(&temperature, sizeof(temperature));
+        key.add(&TopP, sizeof(TopP)).add(&TopK, sizeof(TopK));
+        key.add(&codeExecution, sizeof(codeExecution)).add(&googleSearch, sizeof(googleSearch));
+        key.add(&plain, sizeof(plain));
+        {
+          StatsLock lock(*this);
+          key.add(cacheName);
+        }
+        return key.add(question);
+      }
+
+      String _coalescedRequest(const String& question, std::function < void(char) > onChar, bool plain) {
+        _ensureCache();
+        #if defined(ESP32)
+          if (Policy::coalescing && coalescing) {
+            return RequestCoalescer::shared().run(_requestKey(question, plain), [this, &question, plain](std::function < void(char) > publish) {
+              _generate(&question, 0, true, publish, plain);
+            }, onChar);
+          }
+        #endif
+        return _generate(&question, 0, !onChar, onChar, plain);
+      }
+
     public:
 
-      Gemini_AI() {}
-      ~Gemini_AI() {}
+      BasicGemini() {}
+      ~BasicGemini() {}
 
-      bool begin() {
+      // `arenaSize` bytes are allocated once for all per-request scratch memory (see Policy::arenaSize).
+      bool begin(size_t arenaSize = Policy::arenaSize) {
+        if (!arena.begin(arenaSize)) {
+          debuglnF("Failed to allocate request arena!");
+          return false;
+        }
         if (WiFi.status() != WL_CONNECTED) {
           debuglnF("WiFi not connected!");
           return false;
@@ -281,23 +989,37 @@
         apiKey = t; 
       }
     
+      void useEmbeddingModel(const char* m) {
+        embeddingModel = m;
+      }
+
+      // Fixed maxOutputTokens for every request (still limited by memory for getAnswer()). 0 = chosen per request.
       void setMaxTokens(int t) {
         maxTokens = t;
       }
+
+      // Questions whose estimated prompt (system instruction + question) is larger are not sent. 0 = no limit.
+      void setMaxPromptTokens(int t) {
+        maxPromptTokens = t;
+      }
     
       void setTemperature(float t) {
+        static_assert(Policy::sampling, "Sampling is disabled by the Gemini policy");
         temperature = t;
       }
     
       void setTopP(float p) {
+        static_assert(Policy::sampling, "Sampling is disabled by the Gemini policy");
         TopP = p;
       }
     
       void setTopK(float k) {
+        static_assert(Policy::sampling, "Sampling is disabled by the Gemini policy");
         TopK = k;
       }
     
       void enableCodeExecution()  { 
+        static_assert(Policy::tools, "Tools is disabled by the Gemini policy");
         codeExecution = true; 
       }
     
@@ -306,6 +1028,7 @@
       }
     
       void enableGoogleSearch()  { 
+        static_assert(Policy::tools, "Tools is disabled by the Gemini policy");
         googleSearch = true;  
       }
     
@@ -313,10 +1036,187 @@
         googleSearch = false;
       }
       
+      // Identical concurrent questions from several tasks share one request. No effect on ESP8266.
+      void enableRequestCoalescing() {
+        static_assert(Policy::coalescing, "Request coalescing is disabled by the Gemini policy");
+        coalescing = true;
+      }
+
+      void disableRequestCoalescing() {
+        coalescing = false;
+      }
+
+      // Up to `connections` kept-alive connections (as many as the free heap allows), each with its own arena, so
+      // several tasks get answers in parallel and repeated requests skip the TLS handshake. Returns the number of
+      // connections, 0 on ESP8266. Don't change the configuration while tasks are sending requests.
+      size_t enableConnectionPool(size_t connections = CLIENT_POOL_MAX) {
+        static_assert(Policy::pooling, "Connection pooling is disabled by the Gemini policy");
+        #if defined(ESP32)
+          if (!pool) {
+            pool.reset(new (std::nothrow) ClientPool<Transport>());
+          }
+          size_t size = pool ? pool->begin(connections, arena.capacity() ? arena.capacity() : Policy::arenaSize) : 0;
+          if (size == 0) {
+            debuglnF("Failed to allocate the connection pool!");
+            pool.reset();
+          } else {
+            pool->setIdleTimeout(keepAliveIdle > 0 ? keepAliveIdle : CLIENT_POOL_IDLE_TIMEOUT);
+          }
+          return size;
+        #else
+          (void)connections;
+          return 0;
+        #endif
+      }
+
+      void disableConnectionPool() {
+        #if defined(ESP32)
+          pool.reset();
+        #endif
+      }
+
+      // Keeps connections open for `idleMs` after a request, so the next one skips DNS, TCP and TLS setup.
+      // 0 (the default) closes them after every request. Pool connections are always kept, for
+      // CLIENT_POOL_IDLE_TIMEOUT unless set here.
+      void setKeepAlive(uint32_t idleMs) {
+        keepAliveIdle = idleMs;
+        connection.setKeepAlive(idleMs > 0);
+        if (idleMs == 0) {
+          connection.close();
+        }
+        #if defined(ESP32)
+          if (pool) {
+            pool->setIdleTimeout(idleMs > 0 ? idleMs : CLIENT_POOL_IDLE_TIMEOUT);
+          }
+        #endif
+      }
+
+      uint32_t getKeepAlive() {
+        return keepAliveIdle;
+      }
+
+      // Opens a connection (DNS, TCP and TLS) now, e.g. while the user is still typing or speaking, so the next
+      // request is sent right away. Turns keep-alive on (GEMINI_KEEPALIVE_IDLE) if it is off. With the pool,
+      // opens up to `connections` free pool connections. Returns the number of open connections.
+      size_t prewarm(size_t connections = 1) {
+        if (!_online()) {
+          debuglnF("WiFi not connected!");
+          return 0;
+        }
+        lastPrewarm = millis();
+        #if defined(ESP32)
+          if (pool) {
+            return pool->warm(connections, [this](Transport& client, RequestArena& slotArena) {
+              return _openConnection(client, &slotArena);
+            });
+          }
+        #else
+          (void)connections;
+        #endif
+        if (keepAliveIdle == 0) {
+          setKeepAlive(GEMINI_KEEPALIVE_IDLE);
+        }
+        _expireConnection();
+        if (connection.healthy()) {
+          return 1;
+        }
+        if (!_openConnection(connection, &arena)) {
+          return 0;
+        }
+        connectionUsed = millis();
+        return 1;
+      }
+
+      // Lets maintainConnections() keep `connections` connections open in the background.
+      void enableAutoPrewarm(size_t connections = 1) {
+        autoPrewarm = connections;
+      }
+
+      void disableAutoPrewarm() {
+        autoPrewarm = 0;
+      }
+
+      // Call regularly, e.g. from loop(): closes kept-alive connections that have been idle for too long, and with
+      // auto prewarming opens connections again (at most every GEMINI_PREWARM_INTERVAL), so requests after a quiet
+      // period don't wait for a handshake either. With the pool it may run in its own task; without the pool,
+      // call it from the task that sends the requests.
+      void maintainConnections() {
+        bool due = lastPrewarm == 0 || millis() - lastPrewarm >= GEMINI_PREWARM_INTERVAL;
+        #if defined(ESP32)
+          if (pool) {
+            pool->evictIdle();
+            if (autoPrewarm > 0 && due && pool->openCount() < std::min(autoPrewarm, pool->size())) {
+              prewarm(autoPrewarm);
+            }
+            return;
+          }
+        #endif
+        if (keepAliveIdle > 0) {
+          _expireConnection();
+        }
+        if (autoPrewarm > 0 && due && !connection.healthy()) {
+          prewarm();
+        }
+      }
+
+      ConnectionStats getConnectionStats() {
+        StatsLock lock(*this);
+        ConnectionStats stats = connectionStats;
+        #if defined(ESP32)
+          stats.dnsHits = HostCache::hits();
+        #endif
+        return stats;
+      }
+
+      // Closes pooled connections idle for `maxIdleMs`, giving their TLS memory back. Returns how many were closed.
+      size_t evictIdleConnections(uint32_t maxIdleMs = CLIENT_POOL_IDLE_TIMEOUT) {
+        #if defined(ESP32)
+          return pool ? pool->evictIdle(maxIdleMs) : 0;
+        #else
+          (void)maxIdleMs;
+          return 0;
+        #endif
+      }
+
+      // Ask the server for gzip-compressed responses, inflated on the fly while parsing.
+      void enableCompression() {
+        static_assert(Policy::compression, "Compression is disabled by the Gemini policy");
+        compression = true;
+      }
+
+      void disableCompression() {
+        compression = false;
+      }
+
+      // getAnswer(), getAnswerStream() and getAnswerEvents() come as plain text: markdown syntax is removed while
+      // they stream in. Off by default; getAnswerSentences() always removes it.
+      void enableMarkdownFilter() {
+        static_assert(Policy::markdownFilter, "The markdown filter is disabled by the Gemini policy");
+        markdownFilter = true;
+      }
+
+      void disableMarkdownFilter() {
+        markdownFilter = false;
+      }
+
+      // Records every response with its timing to `sink` (a File, or Serial), nullptr to stop. See TrafficCapture.hpp.
+      void setCapture(Print* sink) {
+        capture = sink;
+      }
+
+      // Answers requests from a recorded capture instead of the network, nullptr to go back online.
+      void setReplay(ReplayStream* source) {
+        replay = source;
+      }
+
       const char* getModel() {
         return model;
       }
     
+      const char* getEmbeddingModel() {
+        return embeddingModel;
+      }
+
       const char* getSystemInstruction() {
         return systemInstruction;
       }
@@ -328,6 +1228,31 @@
       int getMaxTokens() {
         return maxTokens;
       }
+
+      int getMaxPromptTokens() {
+        return maxPromptTokens;
+      }
+
+      // Estimated and billed tokens of the last request, and the maxOutputTokens it was sent with.
+      TokenUsage getLastUsage() {
+        StatsLock lock(*this);
+        return usage;
+      }
+
+      #if defined(ESP32)
+        ClientPoolStats getPoolStats() {
+          return pool ? pool->stats() : ClientPoolStats();
+        }
+
+        size_t getPoolSize() {
+          return pool ? pool->size() : 0;
+        }
+      #endif
+
+      // Its calibration can be saved and restored, e.g. across deep sleep (not while requests are running).
+      TokenEstimator& getTokenEstimator() {
+        return estimator;
+      }
     
       float getTemperature() {
         return temperature;
@@ -348,15 +1273,368 @@
       bool getGoogleSearch() { 
         return googleSearch;
       }
+
+      bool getRequestCoalescing() {
+        return coalescing;
+      }
+
+      bool getCompression() {
+        return compression;
+      }
+
+      bool getMarkdownFilter() {
+        return markdownFilter;
+      }
+
+      size_t getArenaSize() {
+        return arena.capacity();
+      }
+
+      // Largest amount of the request arena any request has needed so far.
+      size_t getArenaHighWater() {
+        return arena.highWater();
+      }
     
-      String getAnswer(const String& question) {
-        return _sendRequest(question);
+      // Uploads the system instruction (and an optional large document) once to the cachedContents
+      // endpoint. Later requests only refer to the cache, which is refreshed automatically before it expires.
+      // `document` must stay valid while the cache is in use. Gemini requires a minimum cached size (~1024+ tokens).
+      bool createCache(const char* document = nullptr, uint32_t ttlSeconds = 3600) {
+        static_assert(Policy::caching, "Context caching is disabled by the Gemini policy");
+        if (!_online()) {
+          debuglnF("WiFi not connected!");
+          return false;
+        }
+        deleteCache();
+        ArenaLease lease(*this);
+        if (!lease.get()) {
+          return false;
+        }
+        RequestArena::Scope scope(*lease.get());
+        Transport client;
+        if (!_beginClient(client, model, lease.get())) {
+          client.end();
+          debuglnF("GeminiClient Begin Failed.");
+          return false;
+        }
+        client.setPath("/v1beta/cachedContents");
+        size_t size = _writeCacheBody(nullptr, document, ttlSeconds);
+        int httpcode = client.POST(size, [this, document, ttlSeconds](Print& out) {
+          _writeCacheBody(&out, document, ttlSeconds);
+        });
+        if (httpcode != 200) {
+          client.end();
+          debugln("Cache creation failed: " + String(httpcode) + ", " + client.errorToString(httpcode));
+          return false;
+        }
+        StreamJsonParser parser = _parser(client.getBodyStream());
+        String name;
+        if (parser.find("name")) {
+          parser.getValueStream([&name](char c) {
+            name += c;
+          });
+        }
+        client.end();
+        if (name.length() == 0) {
+          debuglnF("Couldn't find cache \"name\" in response!");
+          return false;
+        }
+        debugln("Created cache " + name);
+        StatsLock lock(*this);
+        cacheName = name;
+        cacheDocument = document;
+        cacheTtl = ttlSeconds;
+        cacheExpiresAt = _cacheDeadline(ttlSeconds);
+        return true;
+      }
+
+      bool refreshCache() {
+        String name;
+        uint32_t ttl;
+        {
+          StatsLock lock(*this);
+          name = cacheName;
+          ttl = cacheTtl;
+        }
+        if (name.length() == 0 || !_online()) {
+          return false;
+        }
+        ArenaLease lease(*this);
+        if (!lease.get()) {
+          return false;
+        }
+        RequestArena::Scope scope(*lease.get());
+        Transport client;
+        if (!_beginClient(client, model, lease.get())) {
+          client.end();
+          return false;
+        }
+        client.setPath("/v1beta/" + name);
+        int httpcode = client.PATCH("{\"ttl\":\"" + String(ttl) + "s\"}");
+        client.end();
+        if (httpcode != 200) {
+          debugln("Cache refresh failed: " + String(httpcode) + ", " + client.errorToString(httpcode));
+          return false;
+        }
+        StatsLock lock(*this);
+        if (cacheName == name) {
+          cacheExpiresAt = _cacheDeadline(ttl);
+        }
+        return true;
+      }
+
+      void deleteCache() {
+        String name;
+        {
+          StatsLock lock(*this);
+          name = cacheName;
+          cacheName = "";
+          cacheDocument = nullptr;
+        }
+        if (name.length() == 0 || !_online()) {
+          return;
+        }
+        ArenaLease lease(*this);
+        if (!lease.get()) {
+          return;
+        }
+        RequestArena::Scope scope(*lease.get());
+        Transport client;
+        if (_beginClient(client, model, lease.get())) {
+          client.setPath("/v1beta/" + name);
+          client.DELETE();
+        }
+        client.end();
+      }
+
+      // A copy, as requests on other tasks may renew the cache meanwhile.
+      String getCacheName() {
+        StatsLock lock(*this);
+        return cacheName;
+      }
+
+      Output getAnswer(const String& question) {
+        if constexpr (std::is_constructible<Output, String>::value) {
+          return Output(_coalescedRequest(question, nullptr, markdownFilter));
+        } else {
+          return Output(_coalescedRequest(question, nullptr, markdownFilter).c_str());
+        }
       }
 
       void getAnswerStream(const String& question, std::function < void(char) > onChar) {
-        _sendRequest(question, onChar);
+        _coalescedRequest(question, onChar, markdownFilter);
+      }
+
+      // Writes the answer to `out`, e.g. an OutputBuffer that feeds slow outputs without holding up the socket.
+      void getAnswerStream(const String& question, Print& out) {
+        _coalescedRequest(question, [&out](char c) {
+          out.write((uint8_t)c);
+        }, markdownFilter);
+        out.flush();
+      }
+
+      // Streams every part of the answer to its own callback in one pass: text, the code the model ran and its
+      // output (enableCodeExecution()), and the Google Search sources (enableGoogleSearch()). Parts without a
+      // callback are skipped without being parsed. Returns the number of parts and sources delivered.
+      size_t getAnswerEvents(const String& question, const ResponseEvents& events) {
+        size_t delivered = 0;
+        ResponseEvents counted = events;
+        counted.onPartEnd = [&](ResponsePart part) {
+          delivered++;
+          if (events.onPartEnd) {
+            events.onPartEnd(part);
+          }
+        };
+        if (events.onSource) {
+          counted.onSource = [&](const char* uri, const char* title) {
+            delivered++;
+            events.onSource(uri, title);
+          };
+        }
+        _ensureCache();
+        _generate(&question, 0, false, events.onText, markdownFilter, &counted);
+        return delivered;
+      }
+
+      // Streams the answer one sentence (or clause, for long ones) at a time as soon as it is complete,
+      // e.g. to start text-to-speech on the first sentence, with the markdown syntax removed. `sentence` is only
+      // valid during the call.
+      void getAnswerSentences(const String& question, std::function < void(const char*) > onSentence) {
+        SentenceSegmenter segmenter([&onSentence](const char* sentence, size_t) {
+          onSentence(sentence);
+        });
+        _coalescedRequest(question, [&segmenter](char c) {
+          segmenter.push(c);
+        }, Policy::markdownFilter);
+        segmenter.finish();
+      }
+
+      size_t getAnswersStream(const String* questions, size_t count, std::function < void(size_t, char) > onChar, BatchItemStats* stats = nullptr) {
+        static_assert(Policy::batch, "Batch questions are disabled by the Gemini policy");
+        if (count == 0) {
+          return 0;
+        }
+        // Structured output can't be combined with tools: refuse instead of answering without them.
+        if (Policy::tools && (googleSearch || codeExecution)) {
+          debuglnF("Batch questions can't use Google Search or code execution, disable them first.");
+          return 0;
+        }
+        if (stats) {
+          std::fill(stats, stats + count, BatchItemStats());
+        }
+        _ensureCache();
+        unsigned long start = millis();
+        size_t current = 0;
+        auto deliver = [&](char c) {
+          if (stats) {
+            if (stats[current].length == 0) {
+              stats[current].firstCharMs = millis() - start;
+            }
+            stats[current].length++;
+          }
+          onChar(current, c);
+        };
+        // The markdown filter runs per item, on the decoded strings rather than the JSON array.
+        MarkdownStripper stripper(deliver);
+        BatchAnswerDemux demux([&](size_t index, char c) {
+          if (index >= count) {
+            return;
+          }
+          current = index;
+          if (Policy::markdownFilter && markdownFilter) {
+            stripper.push(c);
+          } else {
+            deliver(c);
+          }
+        }, [&](size_t index) {
+          if (index >= count) {
+            return;
+          }
+          if (Policy::markdownFilter && markdownFilter) {
+            stripper.finish();
+            stripper.reset();
+          }
+          if (stats) {
+            stats[index].totalMs = millis() - start;
+          }
+        });
+        _generate(questions, count, false, [&demux](char c) {
+          demux.push(c);
+        });
+        return std::min(demux.completed(), count);
+      }
+
+      // Local estimate, no network.
+      uint32_t estimateTokens(const String& text) {
+        StatsLock lock(*this);
+        return estimator.estimate(text.c_str(), text.length());
+      }
+
+      // Exact count from the API (`:countTokens`, free of charge), which also calibrates estimateTokens().
+      // Returns -1 on failure.
+      long countTokens(const String& text) {
+        if (!_online()) {
+          debuglnF("WiFi not connected!");
+          return -1;
+        }
+        ArenaLease lease(*this);
+        if (!lease.get()) {
+          return -1;
+        }
+        RequestArena& arena = *lease.get();
+        RequestArena::Scope scope(arena);
+        Transport client;
+        if (!_beginClient(client, model, &arena)) {
+          client.end();
+          debuglnF("GeminiClient Begin Failed.");
+          return -1;
+        }
+        client.setAction("countTokens");
+        char* payload = _payloadBuffer(arena);
+        if (!payload) {
+          client.end();
+          return -1;
+        }
+        JsonBuilder builder(payload, Policy::payloadBufferSize, false);
+        builder.beginObject();
+        builder.key("contents");
+        builder.beginArray();
+        builder.beginObject();
+        builder.key("parts");
+        builder.beginArray();
+        builder.beginObject();
+        builder.key("text");
+        builder.value(text);
+        builder.endObject();
+        builder.endArray();
+        builder.endObject();
+        builder.endArray();
+        builder.endObject();
+        if (builder.overflowed()) {
+          client.end();
+          debuglnF("Payload too large, not sent. Increase the payload buffer (Policy::payloadBufferSize)!");
+          return -1;
+        }
+        int httpcode = client.POST(payload, strlen(payload));
+        arena.reset();
+        if (httpcode != 200) {
+          client.end();
+          debugln("countTokens failed: " + String(httpcode) + ", " + client.errorToString(httpcode));
+          return -1;
+        }
+        StreamJsonParser parser = _parser(client.getBodyStream());
+        long total = -1;
+        if (parser.find("totalTokens")) {
+          total = 0;
+          parser.getValueStream([&total](char c) {
+            if (isdigit((uint8_t)c)) total = total * 10 + (c - '0');
+          });
+        }
+        client.end();
+        if (total >= 0) {
+          StatsLock lock(*this);
+          estimator.calibrate(TokenEstimator::weigh(text.c_str(), text.length()), total);
+        }
+        return total;
+      }
+
+      size_t getAnswers(const String* questions, String* answers, size_t count, BatchItemStats* stats = nullptr) {
+        return getAnswersStream(questions, count, [answers](size_t index, char c) {
+          answers[index] += c;
+        }, stats);
+      }
+
+      bool getEmbedding(const String& text, int8_t* out, size_t dims, float* invNorm = nullptr) {
+        return _sendEmbedRequest(&text, 1, out, dims, invNorm) == 1;
+      }
+
+      size_t getEmbeddings(const String* texts, size_t count, int8_t* out, size_t dims, float* invNorms = nullptr) {
+        return _sendEmbedRequest(texts, count, out, dims, invNorms);
+      }
+
+      int addEmbedding(EmbeddingIndex& index, const String& text) {
+        int8_t* slot = index.nextSlot();
+        float invNorm = 0;
+        if (!slot || !getEmbedding(text, slot, index.dims(), &invNorm)) {
+          return -1;
+        }
+        return index.commit(invNorm);
+      }
+
+      size_t searchEmbedding(EmbeddingIndex& index, const String& query, EmbeddingMatch* out, size_t k) {
+        std::unique_ptr<int8_t[]> vector(new (std::nothrow) int8_t[index.dims()]);
+        float invNorm = 0;
+        if (!vector) {
+          debuglnF("Failed to allocate query embedding!");
+          return 0;
+        }
+        if (!getEmbedding(query, vector.get(), index.dims(), &invNorm)) {
+          return 0;
+        }
+        return index.search(vector.get(), invNorm, out, k);
       }
   };
+
+  typedef BasicGemini<DefaultGeminiPolicy> Gemini_AI;
 #else
   #error "Gemini_AI requires a C++ compiler. Please rename your file to .cpp or .cc"
 #endif
@@ -0,0 +1,394 @@
+/*
+ * GzipStream.hpp - A streaming gzip (RFC 1952 / deflate RFC 1951) decompressor for ESP8266/ESP32.
+ *
+ * Wraps the socket (or any Stream) and exposes the inflated bytes through the regular Stream interface,
+ * so it can sit between GeminiClient and StreamJsonParser without either of them knowing about it.
+ *
+ * Output is produced lazily one deflate symbol at a time, straight into a fixed ring buffer that doubles as
+ * the LZ77 history window and the read buffer, so the only allocation is the window itself. The window can be
+ * smaller than deflate's 32 KB maximum: back-references can never reach further back than the bytes produced
+ * so far, so any response smaller than the window always decodes. A reference beyond the window is reported
+ * as an error instead of returning corrupt data.
+ *
+ * Waiting for compressed bytes is bounded by an idle and a total deadline (setTimeouts(), normally the request's
+ * own). A source that stays dry between reads fails the stream by the same deadlines, and once the stream has
+ * failed nothing waits any more.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.2
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Stream.h>
+
+#ifndef GZIP_WINDOW_SIZE
+  #if defined(ESP8266)
+    #define GZIP_WINDOW_SIZE 8192
+  #else
+    #define GZIP_WINDOW_SIZE 32768
+  #endif
+#endif
+
+// A single match (up to 258 bytes) must fit in the window next to the history it copies from.
+#define GZIP_MIN_WINDOW 1024
+
+// Default idle deadline: longest wait for the next compressed byte (ms).
+#ifndef GZIP_WAIT_TIMEOUT
+#define GZIP_WAIT_TIMEOUT 5000
+#endif
+
+// Most deflate steps (block headers or symbols) available() runs before it returns.
+#ifndef GZIP_MAX_STEPS
+#define GZIP_MAX_STEPS 64
+#endif
+
+static const uint16_t gzip_length_base[29] PROGMEM = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t gzip_length_bits[29] PROGMEM = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t gzip_dist_base[30] PROGMEM = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+  4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t gzip_dist_bits[30] PROGMEM = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t gzip_code_order[19] PROGMEM = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+class GzipStream : public Stream {
+public:
+  GzipStream(Stream& source, size_t windowSize = GZIP_WINDOW_SIZE)
+    : _source(source), _windowSize(std::max(windowSize, (size_t)GZIP_MIN_WINDOW)) {
+    _window = (uint8_t*)malloc(_windowSize);
+    if (!_window) {
+      Serial.println(F("Error: Failed to allocate gzip window!"));
+      _state = ERROR;
+    }
+  }
+
+  // Uses a caller-provided window (e.g. from a RequestArena) instead of allocating one.
+  GzipStream(Stream& source, uint8_t* window, size_t windowSize)
+    : _source(source), _window(window), _windowSize(windowSize), _ownsWindow(false) {
+    if (windowSize < GZIP_MIN_WINDOW) {
+      _state = ERROR;
+    }
+  }
+
+  ~GzipStream() {
+    if (_ownsWindow) free(_window);
+  }
+
+  GzipStream(const GzipStream&) = delete;
+  GzipStream& operator=(const GzipStream&) = delete;
+
+  // Decodes a bounded number of symbols per call, so a stream of empty blocks can't keep the caller here forever.
+  int available() override {
+    for (uint8_t i = 0; i < GZIP_MAX_STEPS && _unread == 0 && _state != DONE && _state != ERROR && _source.available() > 0; i++) {
+      _produce();
+    }
+    if (_unread == 0 && _state != DONE && _state != ERROR && _source.available() <= 0 && _expired(_lastInput)) {
+      _state = ERROR;
+    }
+    return _unread;
+  }
+
+  int peek() override {
+    if (!available()) return -1;
+    return _window[_tail];
+  }
+
+  int read() override {
+    if (!available()) return -1;
+    uint8_t c = _window[_tail];
+    _tail = (_tail + 1) % _windowSize;
+    _unread--;
+    return c;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+  // Longest wait for the next compressed byte, and for the whole stream since it was created (both in ms).
+  void setTimeouts(uint32_t idleTimeout, uint32_t totalTimeout) {
+    _idleTimeout = idleTimeout;
+    _totalTimeout = totalTimeout;
+  }
+
+  bool finished() const { return _state == DONE; }
+  bool failed() const { return _state == ERROR; }
+  uint32_t compressedBytes() const { return _compressed; }
+  uint32_t inflatedBytes() const { return _inflated; }
+
+private:
+  struct Tree {
+    uint16_t counts[16];
+    uint16_t symbols[288];
+  };
+
+  enum State : uint8_t { HEADER, BLOCK, STORED, HUFFMAN, TRAILER, DONE, ERROR };
+
+  Stream& _source;
+  uint8_t* _window;
+  size_t _windowSize;
+  bool _ownsWindow = true;
+  size_t _head = 0;
+  size_t _tail = 0;
+  size_t _unread = 0;
+  State _state = HEADER;
+  bool _lastBlock = false;
+  uint32_t _bitBuffer = 0;
+  uint8_t _bitCount = 0;
+  uint16_t _storedLeft = 0;
+  uint32_t _compressed = 0;
+  uint32_t _inflated = 0;
+  Tree _literals;
+  Tree _distances;
+  uint32_t _idleTimeout = GZIP_WAIT_TIMEOUT;
+  uint32_t _totalTimeout = 0xFFFFFFFF;
+  unsigned long _start = millis();
+  unsigned long _lastInput = _start;
+
+  bool _expired(unsigned long idleStart) const {
+    unsigned long now = millis();
+    return now - idleStart >= _idleTimeout || now - _start >= _totalTimeout;
+  }
+
+  // Next compressed byte; 0 with the state set to ERROR when a deadline passed or the stream already failed.
+  int _byte() {
+    if (_state == ERROR) {
+      return 0;
+    }
+    unsigned long idleStart = millis();
+    while (_source.available() <= 0) {
+      if (_expired(idleStart)) {
+        _state = ERROR;
+        return 0;
+      }
+      delay(1);
+    }
+    _compressed++;
+    _lastInput = millis();
+    return _source.read() & 0xFF;
+  }
+
+  uint32_t _bits(uint8_t n) {
+    while (_bitCount < n) {
+      _bitBuffer |= (uint32_t)_byte() << _bitCount;
+      _bitCount += 8;
+    }
+    uint32_t v = _bitBuffer & ((1UL << n) - 1);
+    _bitBuffer >>= n;
+    _bitCount -= n;
+    return v;
+  }
+
+  void _emit(uint8_t c) {
+    _window[_head] = c;
+    _head = (_head + 1) % _windowSize;
+    _unread++;
+    _inflated++;
+  }
+
+  void _buildTree(Tree& tree, const uint8_t* lengths, uint16_t count) {
+    uint16_t offsets[16];
+    memset(tree.counts, 0, sizeof(tree.counts));
+    for (uint16_t i = 0; i < count; i++) tree.counts[lengths[i]]++;
+    tree.counts[0] = 0;
+    uint16_t sum = 0;
+    for (uint8_t i = 0; i < 16; i++) {
+      offsets[i] = sum;
+      sum += tree.counts[i];
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      if (lengths[i]) tree.symbols[offsets[lengths[i]]++] = i;
+    }
+  }
+
+  int _decode(const Tree& tree) {
+    int code = 0, first = 0, index = 0;
+    for (uint8_t len = 1; len < 16; len++) {
+      code |= _bits(1);
+      int count = tree.counts[len];
+      if (code - first < count) return tree.symbols[index + code - first];
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    _state = ERROR;
+    return 0;
+  }
+
+  void _fixedTrees() {
+    uint8_t lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    _buildTree(_literals, lengths, 288);
+    memset(lengths, 5, 30);
+    _buildTree(_distances, lengths, 30);
+  }
+
+  void _dynamicTrees() {
+    uint8_t lengths[288 + 32];
+    uint16_t hlit = _bits(5) + 257;
+    uint16_t hdist = _bits(5) + 1;
+    uint8_t hclen = _bits(4) + 4;
+    memset(lengths, 0, 19);
+    for (uint8_t i = 0; i < hclen; i++) {
+      lengths[pgm_read_byte(&gzip_code_order[i])] = _bits(3);
+    }
+    _buildTree(_literals, lengths, 19);
+    uint16_t n = 0;
+    while (n < hlit + hdist && _state != ERROR) {
+      int sym = _decode(_literals);
+      uint8_t repeat = 0, value = 0;
+      if (sym < 16) {
+        lengths[n++] = sym;
+        continue;
+      } else if (sym == 16) {
+        if (n == 0) break;
+        value = lengths[n - 1];
+        repeat = 3 + _bits(2);
+      } else if (sym == 17) {
+        repeat = 3 + _bits(3);
+      } else {
+        repeat = 11 + _bits(7);
+      }
+      if (n + repeat > hlit + hdist) break;
+      while (repeat--) lengths[n++] = value;
+    }
+    if (n != hlit + hdist) {
+      _state = ERROR;
+      return;
+    }
+    _buildTree(_literals, lengths, hlit);
+    _buildTree(_distances, lengths + hlit, hdist);
+  }
+
+  void _readHeader() {
+    if (_byte() != 0x1F || _byte() != 0x8B || _byte() != 8) {
+      _state = ERROR;
+      return;
+    }
+    uint8_t flags = _byte();
+    for (uint8_t i = 0; i < 6; i++) _byte();
+    if (flags & 0x04) {
+      uint16_t extra = _byte();
+      extra |= _byte() << 8;
+      while (extra-- && _state != ERROR) _byte();
+    }
+    if (flags & 0x08) while (_byte() != 0 && _state != ERROR);
+    if (flags & 0x10) while (_byte() != 0 && _state != ERROR);
+    if (flags & 0x02) {
+      _byte();
+      _byte();
+    }
+    if (_state != ERROR) _state = BLOCK;
+  }
+
+  // Produces at most one deflate symbol (<= 258 bytes), only called once every produced byte was read.
+  void _produce() {
+    switch (_state) {
+      case HEADER:
+        _readHeader();
+        break;
+      case BLOCK: {
+        if (_lastBlock) {
+          _state = TRAILER;
+          break;
+        }
+        _lastBlock = _bits(1);
+        uint8_t type = _bits(2);
+        if (type == 0) {
+          _bitBuffer = 0;
+          _bitCount = 0;
+          // Separate statements: the operands of | may be read in either order.
+          uint16_t len = _byte();
+          len |= _byte() << 8;
+          uint16_t nlen = _byte();
+          nlen |= _byte() << 8;
+          if ((uint16_t)~nlen != len) {
+            _state = ERROR;
+            break;
+          }
+          _storedLeft = len;
+          _state = STORED;
+        } else if (type == 1) {
+          _fixedTrees();
+          _state = HUFFMAN;
+        } else if (type == 2) {
+          _dynamicTrees();
+          if (_state != ERROR) _state = HUFFMAN;
+        } else {
+          _state = ERROR;
+        }
+        break;
+      }
+      case STORED:
+        while (_storedLeft > 0 && _unread < 258) {
+          uint8_t c = _byte();
+          if (_state == ERROR) break;
+          _emit(c);
+          _storedLeft--;
+        }
+        if (_storedLeft == 0 && _state != ERROR) _state = BLOCK;
+        break;
+      case HUFFMAN: {
+        int sym = _decode(_literals);
+        if (_state == ERROR) break;
+        if (sym < 256) {
+          _emit(sym);
+        } else if (sym == 256) {
+          _state = BLOCK;
+        } else {
+          sym -= 257;
+          if (sym >= 29) {
+            _state = ERROR;
+            break;
+          }
+          uint16_t length = pgm_read_word(&gzip_length_base[sym]) + _bits(pgm_read_byte(&gzip_length_bits[sym]));
+          int dsym = _decode(_distances);
+          if (dsym >= 30) {
+            _state = ERROR;
+            break;
+          }
+          uint32_t dist = pgm_read_word(&gzip_dist_base[dsym]) + _bits(pgm_read_byte(&gzip_dist_bits[dsym]));
+          if (_state == ERROR) {
+            // The input ran dry somewhere in this match; its length or distance is made up.
+            break;
+          }
+          if (dist > _inflated || dist > _windowSize) {
+            Serial.println(F("Error: gzip back-reference exceeds window!"));
+            _state = ERROR;
+            break;
+          }
+          size_t from = (_head + _windowSize - dist) % _windowSize;
+          while (length--) {
+            _emit(_window[from]);
+            from = (from + 1) % _windowSize;
+          }
+        }
+        break;
+      }
+      case TRAILER: {
+        _bitBuffer = 0;
+        _bitCount = 0;
+        for (uint8_t i = 0; i < 4; i++) _byte();
+        uint32_t size = 0;
+        for (uint8_t i = 0; i < 4; i++) size |= (uint32_t)_byte() << (8 * i);
+        _state = (_state != ERROR && size == _inflated) ? DONE : ERROR;
+        break;
+      }
+      case DONE:
+      case ERROR:
+        break;
+    }
+  }
+};
@@ -0,0 +1,126 @@
+/*
+ * JsonStringEncoder.hpp - Single-pass, word-at-a-time JSON string escaping for ESP8266/ESP32.
+ *
+ * Escapes the body of a JSON string (without the surrounding quotes) straight into a sink, in one pass and
+ * without any intermediate buffer. Runs of bytes that need no escaping are detected a machine word at a time
+ * (4 bytes on ESP8266/ESP32) with SWAR bit tricks and handed to the sink as a single block copy, so a
+ * multi-KB prompt costs a handful of sink writes instead of one per character.
+ *
+ * Escapes `"`, `\` and every control character below 0x20 (`\b \f \n \r \t`, all others as `\u00XX`), which is
+ * exactly what RFC 8259 requires. UTF-8 sequences are passed through untouched.
+ *
+ * A sink is any object with `void write(const char* data, size_t length)`.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Print.h>
+#include <cstring>
+
+struct JsonNullSink {
+  void write(const char*, size_t) {}
+};
+
+struct JsonPrintSink {
+  Print& out;
+  void write(const char* data, size_t length) {
+    out.write((const uint8_t*)data, length);
+  }
+};
+
+class JsonStringEncoder {
+public:
+  // Returns the number of bytes handed to the sink.
+  template <typename Sink>
+  static size_t encode(Sink& sink, const char* s, size_t length) {
+    const char* end = s + length;
+    const char* run = s;
+    const char* p = s;
+    size_t written = 0;
+    while (p < end) {
+      // Word-at-a-time scan of aligned blocks that contain nothing to escape.
+      if (((uintptr_t)p & (sizeof(Word) - 1)) == 0) {
+        Word word;
+        while ((size_t)(end - p) >= sizeof(Word)) {
+          memcpy(&word, p, sizeof(Word));
+          if (_needsEscape(word)) break;
+          p += sizeof(Word);
+        }
+        if (p >= end) break;
+      }
+      uint8_t c = (uint8_t)*p;
+      if (c >= 0x20 && c != '"' && c != '\\') {
+        p++;
+        continue;
+      }
+      if (p > run) {
+        sink.write(run, p - run);
+        written += p - run;
+      }
+      char escaped[6] = { '\\', 0, 0, 0, 0, 0 };
+      size_t n = 2;
+      switch (c) {
+        case '"': escaped[1] = '"'; break;
+        case '\\': escaped[1] = '\\'; break;
+        case '\b': escaped[1] = 'b'; break;
+        case '\f': escaped[1] = 'f'; break;
+        case '\n': escaped[1] = 'n'; break;
+        case '\r': escaped[1] = 'r'; break;
+        case '\t': escaped[1] = 't'; break;
+        default:
+          escaped[1] = 'u';
+          escaped[2] = '0';
+          escaped[3] = '0';
+          escaped[4] = _hex[c >> 4];
+          escaped[5] = _hex[c & 0x0F];
+          n = 6;
+          break;
+      }
+      sink.write(escaped, n);
+      written += n;
+      run = ++p;
+    }
+    if (end > run) {
+      sink.write(run, end - run);
+      written += end - run;
+    }
+    return written;
+  }
+
+  template <typename Sink>
+  static size_t encode(Sink& sink, const char* s) {
+    return s ? encode(sink, s, strlen(s)) : 0;
+  }
+
+  // Escaped size of `s` without writing anything, e.g. for a Content-Length header.
+  static size_t measure(const char* s, size_t length) {
+    JsonNullSink sink;
+    return encode(sink, s, length);
+  }
+
+  static size_t measure(const char* s) {
+    return s ? measure(s, strlen(s)) : 0;
+  }
+
+private:
+  typedef uintptr_t Word;
+
+  static constexpr Word _ones = (Word)-1 / 0xFF;
+  static constexpr Word _highs = _ones * 0x80;
+  static constexpr const char* _hex = "0123456789abcdef";
+
+  // True if any byte of `v` is below 0x20, '"' or '\\'. May report false positives, never false negatives.
+  static bool _needsEscape(Word v) {
+    Word control = (v - _ones * 0x20) & ~v;
+    Word quote = v ^ (_ones * '"');
+    Word backslash = v ^ (_ones * '\\');
+    quote = (quote - _ones) & ~quote;
+    backslash = (backslash - _ones) & ~backslash;
+    return ((control | quote | backslash) & _highs) != 0;
+  }
+};
@@ -0,0 +1,300 @@
+/*
+ * OutputBuffer.hpp - Ring buffer between the response parser and slow outputs for ESP8266/ESP32.
+ *
+ * When the answer goes straight to Serial at 115200 baud or to an SPI display, every character waits for the
+ * output, the parser stops reading, the TLS receive window fills up and the server throttles the response.
+ * An OutputBuffer takes the answer instead (it is a Print) and feeds its outputs ("sinks", up to
+ * OUTPUT_BUFFER_SINKS, all getting the same bytes) only as much as each can take without blocking, as reported
+ * by Print::availableForWrite(). The socket is read at network speed while every sink goes at its own pace;
+ * each sink has its own read position, and the slowest one decides when space is free again. Print's own
+ * availableForWrite() returns 0, and many display and LCD classes don't override it: a sink that reports no room
+ * before it ever received a byte is fed OUTPUT_BUFFER_FALLBACK_CHUNK bytes per pump() instead.
+ *
+ * It is a single-producer, single-consumer ring: one task writes, and pump() runs either in the writing task
+ * (the default, every write pumps) or in exactly one other task (ESP32, setInlinePump(false)).
+ *
+ * When the ring is full:
+ *   OUTPUT_BLOCK        the writer waits for the sinks (counted as stall time, at most the stall timeout).
+ *   OUTPUT_DROP_NEWEST  new bytes are dropped until there is room again.
+ *   OUTPUT_FAIL         everything from the first overflow on is dropped, so the sinks get an intact beginning.
+ * UTF-8 characters are never split: a character is only taken if all of its bytes fit.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.1
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <new>
+
+#ifndef OUTPUT_BUFFER_SINKS
+#define OUTPUT_BUFFER_SINKS 4
+#endif
+
+// How long OUTPUT_BLOCK (and flush()) wait for sinks that take nothing (ms).
+#ifndef OUTPUT_BUFFER_STALL_TIMEOUT
+#define OUTPUT_BUFFER_STALL_TIMEOUT 5000
+#endif
+
+// Bytes per pump() for a sink without a working availableForWrite().
+#ifndef OUTPUT_BUFFER_FALLBACK_CHUNK
+#define OUTPUT_BUFFER_FALLBACK_CHUNK 64
+#endif
+
+enum OutputOverflow : uint8_t {
+  OUTPUT_BLOCK,
+  OUTPUT_DROP_NEWEST,
+  OUTPUT_FAIL
+};
+
+struct OutputBufferStats {
+  uint32_t written = 0;    // Bytes taken into the ring.
+  uint32_t dropped = 0;    // Bytes dropped because the ring was full.
+  uint32_t stalls = 0;     // Writes that waited for the sinks (OUTPUT_BLOCK).
+  uint32_t stallMs = 0;    // Total time writers waited.
+  uint32_t highWater = 0;  // Most bytes ever waiting in the ring.
+};
+
+class OutputBuffer : public Print {
+public:
+  explicit OutputBuffer(OutputOverflow policy = OUTPUT_BLOCK) : _policy(policy) {}
+
+  OutputBuffer(const OutputBuffer&) = delete;
+  OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+  // Allocates the ring, `capacity` rounded up to a power of two.
+  bool begin(size_t capacity) {
+    size_t size = 16;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _ring.reset(new (std::nothrow) uint8_t[size]);
+    _capacity = _ring ? size : 0;
+    reset();
+    return _ring != nullptr;
+  }
+
+  // Adds an output that gets at most `chunk` bytes per pump(). With 0, as many as its availableForWrite() reports,
+  // or OUTPUT_BUFFER_FALLBACK_CHUNK if that is 0 before the sink has taken anything (not implemented).
+  bool addSink(Print& sink, size_t chunk = 0) {
+    if (_sinkCount >= OUTPUT_BUFFER_SINKS) {
+      return false;
+    }
+    _sinks[_sinkCount].print = &sink;
+    _sinks[_sinkCount].chunk = chunk;
+    _sinks[_sinkCount].reportsRoom = false;
+    _sinks[_sinkCount].tail.store(_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _sinkCount++;
+    return true;
+  }
+
+  void setPolicy(OutputOverflow policy) {
+    _policy = policy;
+  }
+
+  // false: pump() is called by another task, writers never feed the sinks themselves.
+  void setInlinePump(bool inlinePump) {
+    _inlinePump = inlinePump;
+  }
+
+  void setStallTimeout(uint32_t ms) {
+    _stallTimeout = ms;
+  }
+
+  size_t write(uint8_t c) override {
+    if (_failed || !_ring) {
+      _stats.dropped++;
+      return 0;
+    }
+    size_t need = 1;
+    if ((c & 0xC0) == 0x80) {
+      // Continuation byte: its room was checked with the first byte of the character.
+      if (_skipping) {
+        _stats.dropped++;
+        return 1;
+      }
+    } else {
+      _skipping = false;
+      need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    }
+    if (_room() < need && !_makeRoom(need)) {
+      _skipping = true;
+      _stats.dropped++;
+      if (_policy != OUTPUT_DROP_NEWEST) {
+        _failed = true;
+        return 0;
+      }
+      return 1;
+    }
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    _ring[head & (_capacity - 1)] = c;
+    _head.store(head + 1, std::memory_order_release);
+    _stats.written++;
+    uint32_t used = _capacity - _room();
+    if (used > _stats.highWater) {
+      _stats.highWater = used;
+    }
+    if (_inlinePump) {
+      pump();
+    }
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t written = 0;
+    while (written < size && write(data[written])) {
+      written++;
+    }
+    return written;
+  }
+
+  int availableForWrite() override {
+    return (int)_room();
+  }
+
+  // Moves waiting bytes to every sink, as many as each takes without blocking. Returns the bytes moved.
+  size_t pump() {
+    uint32_t head = _head.load(std::memory_order_acquire);
+    size_t moved = 0;
+    for (uint8_t i = 0; i < _sinkCount; i++) {
+      Sink& sink = _sinks[i];
+      uint32_t tail = sink.tail.load(std::memory_order_relaxed);
+      while (tail != head) {
+        size_t room = sink.chunk ? sink.chunk : (size_t)std::max(sink.print->availableForWrite(), 0);
+        if (room > 0) {
+          sink.reportsRoom = true;
+        } else if (!sink.reportsRoom) {
+          sink.chunk = OUTPUT_BUFFER_FALLBACK_CHUNK;
+          room = sink.chunk;
+        }
+        size_t contiguous = std::min<size_t>(head - tail, _capacity - (tail & (_capacity - 1)));
+        size_t count = std::min(contiguous, room);
+        if (count == 0) {
+          break;
+        }
+        count = sink.print->write(_ring.get() + (tail & (_capacity - 1)), count);
+        if (count == 0) {
+          break;
+        }
+        tail += count;
+        moved += count;
+        if (sink.chunk) {
+          break;
+        }
+      }
+      sink.tail.store(tail, std::memory_order_release);
+    }
+    return moved;
+  }
+
+  // Waits until every sink has everything (at most the stall timeout without progress).
+  void flush() override {
+    unsigned long start = millis();
+    size_t left = buffered();
+    while (left > 0) {
+      if (_inlinePump) {
+        pump();
+      }
+      size_t now = buffered();
+      if (now < left) {
+        start = millis();
+      } else if (millis() - start >= _stallTimeout) {
+        return;
+      } else {
+        delay(1);
+      }
+      left = now;
+    }
+  }
+
+  // Bytes the slowest sink hasn't received yet.
+  size_t buffered() const {
+    return _capacity - _room();
+  }
+
+  size_t capacity() const {
+    return _capacity;
+  }
+
+  // Data was lost for OUTPUT_FAIL, or because OUTPUT_BLOCK timed out. Cleared by reset().
+  bool failed() const {
+    return _failed;
+  }
+
+  // Empties the ring and clears failed(). Only while nothing writes or pumps.
+  void reset() {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < _sinkCount; i++) {
+      _sinks[i].tail.store(head, std::memory_order_relaxed);
+    }
+    _failed = false;
+    _skipping = false;
+  }
+
+  const OutputBufferStats& stats() const {
+    return _stats;
+  }
+
+private:
+  struct Sink {
+    Print* print = nullptr;
+    size_t chunk = 0;
+    bool reportsRoom = false;  // availableForWrite() has been nonzero, so a 0 means full.
+    std::atomic<uint32_t> tail{0};
+  };
+
+  std::unique_ptr<uint8_t[]> _ring;
+  size_t _capacity = 0;
+  std::atomic<uint32_t> _head{0};
+  Sink _sinks[OUTPUT_BUFFER_SINKS];
+  uint8_t _sinkCount = 0;
+  OutputOverflow _policy;
+  bool _inlinePump = true;
+  bool _failed = false;
+  bool _skipping = false;
+  uint32_t _stallTimeout = OUTPUT_BUFFER_STALL_TIMEOUT;
+  OutputBufferStats _stats;
+
+  size_t _room() const {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t used = 0;
+    for (uint8_t i = 0; i < _sinkCount; i++) {
+      used = std::max(used, head - _sinks[i].tail.load(std::memory_order_acquire));
+    }
+    return _capacity - used;
+  }
+
+  // Tries to free `need` bytes according to the policy.
+  bool _makeRoom(size_t need) {
+    if (_inlinePump) {
+      pump();
+    }
+    if (_policy != OUTPUT_BLOCK || _room() >= need) {
+      return _room() >= need;
+    }
+    unsigned long start = millis();
+    unsigned long progress = start;
+    size_t room = _room();
+    _stats.stalls++;
+    while (room < need) {
+      if (millis() - progress >= _stallTimeout) {
+        break;
+      }
+      delay(1);
+      if (_inlinePump) {
+        pump();
+      }
+      size_t now = _room();
+      if (now > room) {
+        progress = millis();
+      }
+      room = now;
+    }
+    _stats.stallMs += millis() - start;
+    return room >= need;
+  }
+};
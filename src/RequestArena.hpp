@@ -0,0 +1,98 @@
+/*
+ * RequestArena.hpp - A per-instance bump allocator for per-request scratch memory on ESP8266/ESP32.
+ *
+ * One block is allocated once (at begin()) and every per-request buffer is carved out of it: the JSON payload,
+ * the HTTP header, the gzip window and the accumulated answer. After the request the whole arena is released
+ * in O(1) by resetting a single offset, so long-running devices never fragment the heap with a stream of
+ * differently sized Strings and payload buffers, and the loop() stack no longer holds a payload array.
+ *
+ * The most recent allocation can keep growing (see tail()/commit()), which is how answers of unknown length are
+ * accumulated without reallocating.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class RequestArena {
+public:
+  RequestArena() {}
+
+  ~RequestArena() {
+    free(_buffer);
+  }
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  bool begin(size_t size) {
+    if (_buffer && _capacity == size) {
+      reset();
+      return true;
+    }
+    free(_buffer);
+    _buffer = (uint8_t*)malloc(size);
+    _capacity = _buffer ? size : 0;
+    _used = 0;
+    _highWater = 0;
+    return _buffer != nullptr;
+  }
+
+  void end() {
+    free(_buffer);
+    _buffer = nullptr;
+    _capacity = 0;
+    _used = 0;
+  }
+
+  // Returns nullptr when the arena is exhausted; callers fall back to the heap.
+  void* allocate(size_t size, size_t align = 4) {
+    size_t start = (_used + align - 1) & ~(align - 1);
+    if (!_buffer || start + size > _capacity) {
+      return nullptr;
+    }
+    _used = start + size;
+    if (_used > _highWater) _highWater = _used;
+    return _buffer + start;
+  }
+
+  // Free space after the last allocation, extended in place with commit().
+  char* tail() { return (char*)_buffer + _used; }
+
+  bool commit(size_t size) {
+    if (_used + size > _capacity) {
+      return false;
+    }
+    _used += size;
+    if (_used > _highWater) _highWater = _used;
+    return true;
+  }
+
+  void reset() { _used = 0; }
+
+  // Resets the arena when the request that declared it goes out of scope.
+  class Scope {
+  public:
+    explicit Scope(RequestArena& arena) : _arena(arena) {}
+    ~Scope() { _arena.reset(); }
+  private:
+    RequestArena& _arena;
+  };
+
+  bool owns(const void* p) const { return p >= _buffer && p < _buffer + _capacity; }
+
+  size_t capacity() const { return _capacity; }
+  size_t used() const { return _used; }
+  size_t remaining() const { return _capacity - _used; }
+  size_t highWater() const { return _highWater; }
+
+private:
+  uint8_t* _buffer = nullptr;
+  size_t _capacity = 0;
+  size_t _used = 0;
+  size_t _highWater = 0;
+};
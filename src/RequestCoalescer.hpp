@@ -0,0 +1,221 @@
+/*
+ * RequestCoalescer.hpp - Single-flight deduplication of identical in-flight Gemini requests (ESP32).
+ *
+ * When several FreeRTOS tasks ask the identical question with the identical configuration at nearly
+ * the same time, only the first caller (the leader) opens a connection. Later callers attach to the
+ * in-flight request and receive the same streamed characters through a fan-out broadcaster: the leader
+ * appends every character to a shared buffer, followers replay it from their own cursor (so late
+ * joiners still get the answer from the beginning) and then follow it live until the leader finishes.
+ * User callbacks always run in the caller's own task and never under the lock.
+ *
+ * Requests are matched on their whole question and configuration (RequestKey), not on the hash alone, so a
+ * hash collision never hands a caller the answer to a different question. The leader publishes its characters
+ * to the followers a chunk at a time, so the lock is taken once per chunk instead of once per character.
+ *
+ * Completed requests are not cached; a caller arriving after the leader finished starts a new request.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+#ifndef COALESCER_MAX_FLIGHTS
+#define COALESCER_MAX_FLIGHTS 4
+#endif
+
+#ifndef COALESCER_REPLAY_CHUNK
+#define COALESCER_REPLAY_CHUNK 64
+#endif
+
+// Longest time the leader holds back published characters from the followers (ms).
+#ifndef COALESCER_PUBLISH_INTERVAL
+#define COALESCER_PUBLISH_INTERVAL 20
+#endif
+
+// The identity of a request: every field of the question and configuration, added one by one. Two keys are
+// equal only if all fields are; the hash just makes the comparison of different keys quick.
+class RequestKey {
+public:
+  RequestKey& add(const char* s) {
+    const char* value = s ? s : "";
+    // Length-prefixed, so ("ab", "c") and ("a", "bc") differ.
+    _identity += (unsigned long)strlen(value);
+    _identity += ':';
+    _identity += value;
+    _hash = hash(value, _hash);
+    return *this;
+  }
+
+  RequestKey& add(const String& s) {
+    return add(s.c_str());
+  }
+
+  RequestKey& add(const void* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+      _identity += digits[p[i] >> 4];
+      _identity += digits[p[i] & 0x0F];
+    }
+    _identity += ';';
+    _hash = hash(data, length, _hash);
+    return *this;
+  }
+
+  bool operator==(const RequestKey& other) const {
+    return _hash == other._hash && _identity == other._identity;
+  }
+
+  uint32_t value() const {
+    return _hash;
+  }
+
+  // FNV-1a, chainable over several fields of the request.
+  static uint32_t hash(const void* data, size_t length, uint32_t h = 2166136261u) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length--) {
+      h ^= *p++;
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  static uint32_t hash(const char* s, uint32_t h = 2166136261u) {
+    // The terminator is hashed too, so ("ab", "c") and ("a", "bc") differ.
+    return s ? hash(s, strlen(s) + 1, h) : hash("", 1, h);
+  }
+
+private:
+  String _identity;
+  uint32_t _hash = 2166136261u;
+};
+
+#if defined(ESP32)
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+class RequestCoalescer {
+public:
+  static RequestCoalescer& shared() {
+    static RequestCoalescer instance;
+    return instance;
+  }
+
+  // Runs `request` once for all concurrent callers with the same key. `request` receives the publish
+  // callback it must feed every answer character to. Returns the complete answer.
+  String run(const RequestKey& key, std::function<void(std::function<void(char)>)> request, std::function<void(char)> onChar) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::shared_ptr<Flight> flight = _find(key);
+    if (flight) {
+      return _follow(lock, flight, onChar);
+    }
+    int slot = _freeSlot();
+    if (slot < 0) {
+      lock.unlock();
+      String result;
+      request([&result, &onChar](char c) {
+        result += c;
+        if (onChar) onChar(c);
+      });
+      return result;
+    }
+    flight = std::make_shared<Flight>();
+    flight->key = key;
+    _flights[slot] = flight;
+    lock.unlock();
+
+    char pending[COALESCER_REPLAY_CHUNK];
+    size_t count = 0;
+    unsigned long published = millis();
+    auto publish = [&] {
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        flight->output.concat(pending, count);
+      }
+      flight->changed.notify_all();
+      count = 0;
+      published = millis();
+    };
+    request([&](char c) {
+      pending[count++] = c;
+      if (count == sizeof(pending) || millis() - published >= COALESCER_PUBLISH_INTERVAL) {
+        publish();
+      }
+      if (onChar) onChar(c);
+    });
+
+    lock.lock();
+    flight->output.concat(pending, count);
+    flight->done = true;
+    _flights[slot].reset();
+    String result = flight->output;
+    lock.unlock();
+    flight->changed.notify_all();
+    return result;
+  }
+
+  // Number of requests that were served by attaching to another caller's request.
+  uint32_t coalescedCount() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _coalesced;
+  }
+
+private:
+  struct Flight {
+    RequestKey key;
+    String output;
+    bool done = false;
+    std::condition_variable changed;
+  };
+
+  std::mutex _mutex;
+  std::shared_ptr<Flight> _flights[COALESCER_MAX_FLIGHTS];
+  uint32_t _coalesced = 0;
+
+  RequestCoalescer() {}
+
+  std::shared_ptr<Flight> _find(const RequestKey& key) {
+    for (auto& flight : _flights) {
+      if (flight && flight->key == key && !flight->done) return flight;
+    }
+    return nullptr;
+  }
+
+  int _freeSlot() {
+    for (int i = 0; i < COALESCER_MAX_FLIGHTS; i++) {
+      if (!_flights[i]) return i;
+    }
+    return -1;
+  }
+
+  String _follow(std::unique_lock<std::mutex>& lock, std::shared_ptr<Flight> flight, std::function<void(char)>& onChar) {
+    _coalesced++;
+    size_t cursor = 0;
+    char chunk[COALESCER_REPLAY_CHUNK];
+    while (true) {
+      flight->changed.wait(lock, [&] { return flight->done || flight->output.length() > cursor; });
+      while (cursor < flight->output.length()) {
+        size_t n = std::min((size_t)COALESCER_REPLAY_CHUNK, (size_t)flight->output.length() - cursor);
+        memcpy(chunk, flight->output.c_str() + cursor, n);
+        cursor += n;
+        if (onChar) {
+          lock.unlock();
+          for (size_t i = 0; i < n; i++) onChar(chunk[i]);
+          lock.lock();
+        }
+      }
+      if (flight->done) {
+        return flight->output;
+      }
+    }
+  }
+};
+
+#endif
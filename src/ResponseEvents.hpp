@@ -0,0 +1,296 @@
+/*
+ * ResponseEvents.hpp - Typed, single-pass reader for Gemini generateContent responses on ESP8266/ESP32.
+ *
+ * With code execution or Google Search enabled, a response holds several kinds of parts next to each other:
+ *
+ *   {"candidates":[{"content":{"parts":[
+ *       {"text":"..."},
+ *       {"executableCode":{"language":"PYTHON","code":"..."}},
+ *       {"codeExecutionResult":{"outcome":"OUTCOME_OK","output":"..."}},
+ *       {"text":"..."}]},
+ *     "groundingMetadata":{"searchEntryPoint":{...},"groundingChunks":[{"web":{"uri":"...","title":"..."}}],...}}],
+ *    "usageMetadata":{...}}
+ *
+ * ResponseEventReader walks exactly this shape once and hands every part to its own callback while it streams
+ * in. Whatever has no callback (and everything the reader doesn't know, such as the rendered search HTML or
+ * the grounding supports) is skipped a whole batch at a time without looking at keys.
+ *
+ * The helpers are protected, so readers of other messages with the same parts (LiveEventReader) build on them.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "StreamJsonParser.hpp"
+
+// Longer grounding URIs and titles are cut (at a UTF-8 character boundary).
+#ifndef RESPONSE_URI_SIZE
+#define RESPONSE_URI_SIZE 256
+#endif
+
+#ifndef RESPONSE_TITLE_SIZE
+#define RESPONSE_TITLE_SIZE 96
+#endif
+
+enum ResponsePart : uint8_t {
+  PART_TEXT,
+  PART_CODE,
+  PART_CODE_OUTPUT
+};
+
+// Leave a callback empty to skip that kind of part.
+struct ResponseEvents {
+  std::function<void(char)> onText;                                // Answer text.
+  std::function<void(char)> onCode;                                // Code the model ran (code execution).
+  std::function<void(char)> onCodeOutput;                          // Output of that code.
+  std::function<void(const char* uri, const char* title)> onSource; // Google Search source.
+  std::function<void(ResponsePart part)> onPartEnd;                // A text, code or output part is complete.
+  std::function<void(uint32_t prompt, uint32_t answer)> onUsage;   // Tokens billed (usageMetadata).
+};
+
+class ResponseEventReader : public StreamJsonParser {
+public:
+  using StreamJsonParser::StreamJsonParser;
+
+  // Reads the whole response. Returns the number of parts and sources delivered.
+  size_t read(const ResponseEvents& events) {
+    _events = &events;
+    _delivered = 0;
+    _broken = false;
+    _skipWhitespace();
+    while (_waitForData() && _stream.peek() != '{') {
+      _stream.read();
+    }
+    _members([this](const char* key) {
+      if (strcmp(key, "candidates") == 0) {
+        _elements([this] { _candidate(); });
+        return true;
+      }
+      if (strcmp(key, "usageMetadata") == 0 && _events->onUsage) {
+        _usage();
+        return true;
+      }
+      return false;
+    });
+    return _delivered;
+  }
+
+protected:
+  const ResponseEvents* _events = nullptr;
+  size_t _delivered = 0;
+  bool _broken = false;
+
+  // Keys longer than this never match, all keys the reader knows are shorter.
+  static constexpr uint8_t KEY_SIZE = 24;
+
+  void _candidate() {
+    _members([this](const char* key) {
+      if (strcmp(key, "content") == 0) {
+        _members([this](const char* key) {
+          if (strcmp(key, "parts") != 0) return false;
+          _elements([this] { _part(); });
+          return true;
+        });
+        return true;
+      }
+      if (strcmp(key, "groundingMetadata") == 0 && _events->onSource) {
+        _members([this](const char* key) {
+          if (strcmp(key, "groundingChunks") != 0) return false;
+          _elements([this] { _groundingChunk(); });
+          return true;
+        });
+        return true;
+      }
+      return false;
+    });
+  }
+
+  void _part() {
+    _members([this](const char* key) {
+      return _partMember(key);
+    });
+  }
+
+  // One member of a part; false if it is left for skipping.
+  bool _partMember(const char* key) {
+    if (strcmp(key, "text") == 0) {
+      return _deliver(_events->onText, PART_TEXT);
+    }
+    if (strcmp(key, "executableCode") == 0 && _events->onCode) {
+      _members([this](const char* key) {
+        return strcmp(key, "code") == 0 && _deliver(_events->onCode, PART_CODE);
+      });
+      return true;
+    }
+    if (strcmp(key, "codeExecutionResult") == 0 && _events->onCodeOutput) {
+      _members([this](const char* key) {
+        return strcmp(key, "output") == 0 && _deliver(_events->onCodeOutput, PART_CODE_OUTPUT);
+      });
+      return true;
+    }
+    return false;
+  }
+
+  void _groundingChunk() {
+    char uri[RESPONSE_URI_SIZE] = "";
+    char title[RESPONSE_TITLE_SIZE] = "";
+    bool web = false;
+    _members([&](const char* key) {
+      if (strcmp(key, "web") != 0) return false;
+      web = _members([&](const char* key) {
+        if (strcmp(key, "uri") == 0) {
+          _copyString(uri, sizeof(uri));
+          return true;
+        }
+        if (strcmp(key, "title") == 0) {
+          _copyString(title, sizeof(title));
+          return true;
+        }
+        return false;
+      });
+      return true;
+    });
+    if (web && uri[0] != '\0') {
+      _events->onSource(uri, title);
+      _delivered++;
+    }
+  }
+
+  void _usage() {
+    uint32_t prompt = 0;
+    uint32_t answer = 0;
+    bool read = _members([&](const char* key) {
+      // The Live API calls the answer tokens responseTokenCount.
+      uint32_t* count = strcmp(key, "promptTokenCount") == 0 ? &prompt
+                      : strcmp(key, "candidatesTokenCount") == 0 || strcmp(key, "responseTokenCount") == 0 ? &answer : nullptr;
+      if (!count) return false;
+      getValueStream([count](char c) {
+        if (isdigit((uint8_t)c)) *count = *count * 10 + (c - '0');
+      });
+      return true;
+    });
+    if (read) {
+      _events->onUsage(prompt, answer);
+    }
+  }
+
+  // Streams a string value to `onChar`; false (value left for skipping) without a callback.
+  bool _deliver(const std::function<void(char)>& onChar, ResponsePart part) {
+    if (!onChar) {
+      return false;
+    }
+    getValueStream(onChar);
+    if (_events->onPartEnd) {
+      _events->onPartEnd(part);
+    }
+    _delivered++;
+    return true;
+  }
+
+  void _copyString(char* out, size_t size) {
+    size_t length = 0;
+    int cut = -1;
+    getValueStream([&](char c) {
+      if (length + 1 < size) {
+        out[length++] = c;
+      } else if (cut < 0) {
+        cut = (uint8_t)c;
+      }
+    });
+    // Don't leave half a UTF-8 character behind.
+    while (length > 0 && cut >= 0 && (cut & 0xC0) == 0x80) {
+      cut = (uint8_t)out[--length];
+    }
+    out[length] = '\0';
+  }
+
+  // Consumes a key (opening quote already read) into `key`; a key that doesn't fit becomes "".
+  void _readKey(char* key) {
+    uint8_t length = 0;
+    bool fits = true;
+    while (_waitForData()) {
+      char c = _read();
+      if (c == '"') break;
+      if (c == '\\' && _waitForData()) c = _read();
+      if (length < KEY_SIZE - 1) {
+        key[length++] = c;
+      } else {
+        fits = false;
+      }
+    }
+    key[fits ? length : 0] = '\0';
+  }
+
+  // Calls `onMember(key)` for every member of the object at the current position, with the stream at its
+  // value. `onMember` either consumes the value and returns true, or returns false to have it skipped.
+  // Returns true if the object was read to its end.
+  template <typename F>
+  bool _members(F onMember) {
+    _skipWhitespace();
+    if (_broken || !_waitForData()) {
+      return false;
+    }
+    char first = _stream.peek();
+    if (first != '{') {
+      // Anything else that can't start a value would never be consumed.
+      if (first != '\0' && strchr("\"[-0123456789tfn", first) != nullptr) {
+        _skipValue();
+      } else {
+        _broken = true;
+      }
+      return false;
+    }
+    _read();
+    char key[KEY_SIZE];
+    while (!_broken) {
+      _skipWhitespace();
+      if (!_waitForData()) break;
+      char c = _read();
+      if (c == '}') return true;
+      if (c == ',') continue;
+      if (c != '"') break;
+      _readKey(key);
+      _skipWhitespace();
+      if (!_waitForData() || _read() != ':') break;
+      _skipWhitespace();
+      if (!onMember(key)) {
+        _skipValue();
+      }
+    }
+    _broken = true;
+    return false;
+  }
+
+  // Calls `onElement()` for every element of the array at the current position; it must consume it.
+  template <typename F>
+  void _elements(F onElement) {
+    _skipWhitespace();
+    if (_broken || !_waitForData()) {
+      return;
+    }
+    if (_stream.peek() != '[') {
+      _skipValue();
+      return;
+    }
+    _read();
+    while (!_broken) {
+      _skipWhitespace();
+      if (!_waitForData()) break;
+      char c = _stream.peek();
+      if (c == ']') {
+        _read();
+        return;
+      }
+      if (c == ',') {
+        _read();
+        continue;
+      }
+      onElement();
+    }
+    _broken = true;
+  }
+};
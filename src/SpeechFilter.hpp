@@ -0,0 +1,434 @@
+/*
+ * SpeechFilter.hpp - Streaming markdown stripper and sentence segmenter for text-to-speech on ESP8266/ESP32.
+ *
+ * Both are push-based state machines that work on the answer character by character while it streams in:
+ *
+ * - MarkdownStripper removes markdown syntax (emphasis, headings, quotes, list bullets, horizontal rules, link
+ *   and image syntax) and passes everything else through. Inline code and code fences are passed through
+ *   unchanged. Emphasis and link text are held back until their closing marker shows they really are markdown
+ *   (at most MARKDOWN_HOLD_SIZE bytes, never past the end of the line); otherwise they go out as they came, so
+ *   "2*3", "arr[0]" and tables are untouched.
+ * - SentenceSegmenter collects the text into a fixed buffer and hands out every sentence as soon as its end
+ *   arrives, so speech can start with the first sentence instead of the whole answer. A sentence that outgrows
+ *   the buffer is split at the last clause (, ; :), otherwise at the last space.
+ *
+ * Only ASCII bytes are ever interpreted. UTF-8 sequences pass through unchanged and are never split, and the
+ * full-width CJK terminators 。！？ end a sentence too.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+// Longest emphasis or link text held back until its closing marker; longer ones are passed through as they came.
+#ifndef MARKDOWN_HOLD_SIZE
+#define MARKDOWN_HOLD_SIZE 128
+#endif
+
+#ifndef MARKDOWN_MAX_NESTING
+#define MARKDOWN_MAX_NESTING 4
+#endif
+
+#ifndef SENTENCE_BUFFER_SIZE
+#define SENTENCE_BUFFER_SIZE 192
+#endif
+
+class MarkdownStripper {
+public:
+  MarkdownStripper(std::function<void(char)> onChar) : _onChar(onChar) {}
+
+  void push(char c) {
+    switch (_state) {
+      case FENCE:
+        _fence(c);
+        return;
+      case CODE_SPAN:
+        _codeSpan(c);
+        return;
+      case LINK_URL:
+        if (c == '(') {
+          _parens++;
+        } else if (c == ')' && _parens-- == 0) {
+          _state = TEXT;
+        } else if (c == '\n') {
+          _state = TEXT;
+          _emit(c);
+        }
+        return;
+      case TEXT:
+        break;
+    }
+    if (_run) {
+      if (c == _run && _run != '!' && _run != ']' && _run != '\\' && _runLength < 255) {
+        _runLength++;
+        return;
+      }
+      if (_resolve(c)) return;
+    }
+    switch (c) {
+      case '*': case '_': case '`': case '~': case '!': case ']': case '\\':
+        _startRun(c);
+        break;
+      case '#': case '-': case '+': case '>':
+        if (_lineStart) {
+          _startRun(c);
+        } else {
+          _emit(c);
+        }
+        break;
+      case '[':
+        if (!_open('[', _image ? 2 : 1)) {
+          if (_image) _emit('!');
+          _emit(c);
+        }
+        _image = false;
+        break;
+      default:
+        _emit(c);
+        break;
+    }
+  }
+
+  // Resolves a marker still waiting for its next character and lets go of held text. Call once at the end of
+  // the answer.
+  void finish() {
+    if (_run) _resolve('\n');
+    _release();
+  }
+
+  void reset() {
+    _state = TEXT;
+    _run = 0;
+    _runLength = 0;
+    _lineStart = true;
+    _image = false;
+    _prev = ' ';
+    _held = 0;
+    _depth = 0;
+  }
+
+private:
+  enum State : uint8_t { TEXT, FENCE, CODE_SPAN, LINK_URL };
+
+  // An emphasis (marker and run length) or link text ('[', length 2 for an image) waiting for its end.
+  struct Open {
+    size_t start;
+    char marker;
+    uint8_t length;
+  };
+
+  std::function<void(char)> _onChar;
+  State _state = TEXT;
+  char _run = 0;
+  uint8_t _runLength = 0;
+  bool _runAtLineStart = false;
+  bool _lineStart = true;
+  bool _image = false;
+  uint8_t _parens = 0;
+  uint8_t _codeLength = 0;
+  uint8_t _ticks = 0;
+  bool _tickLine = false;
+  char _prev = ' ';
+  char _hold[MARKDOWN_HOLD_SIZE];
+  size_t _held = 0;
+  Open _opened[MARKDOWN_MAX_NESTING];
+  uint8_t _depth = 0;
+
+  static bool _isWord(char c) {
+    return isalnum((uint8_t)c) || (uint8_t)c >= 0x80;
+  }
+
+  static bool _isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  // Output goes to the hold buffer while an emphasis or a link is open. It never spans a line.
+  void _emit(char c) {
+    if (_depth > 0 && (c == '\n' || _held == MARKDOWN_HOLD_SIZE)) {
+      _release();
+    }
+    if (c == '\n') {
+      _lineStart = true;
+    } else if (c != ' ' && c != '\t') {
+      _lineStart = false;
+    }
+    _prev = c;
+    if (_depth > 0) {
+      _hold[_held++] = c;
+    } else {
+      _onChar(c);
+    }
+  }
+
+  void _emitRun(char run, uint8_t length) {
+    while (length--) _emit(run);
+  }
+
+  // Gives up on every open emphasis and link: the held text goes out as it came, markers included.
+  void _release() {
+    for (size_t i = 0; i < _held; i++) _onChar(_hold[i]);
+    _held = 0;
+    _depth = 0;
+  }
+
+  // Holds the marker and the text after it until its end decides what it was. False if there is no room.
+  bool _open(char marker, uint8_t length) {
+    if (_depth == MARKDOWN_MAX_NESTING || _held + length > MARKDOWN_HOLD_SIZE) {
+      return false;
+    }
+    _opened[_depth++] = {_held, marker, length};
+    for (uint8_t i = 0; i < length; i++) {
+      _hold[_held++] = (marker == '[' && i + 1 < length) ? '!' : marker;
+    }
+    _prev = marker;
+    _lineStart = false;
+    return true;
+  }
+
+  // Innermost open marker of that kind (any length for links), or -1.
+  int _find(char marker, uint8_t length) const {
+    for (int i = _depth - 1; i >= 0; i--) {
+      if (_opened[i].marker == marker && (marker == '[' || _opened[i].length == length)) return i;
+    }
+    return -1;
+  }
+
+  // The marker turned out to be markdown: drop it. Anything opened after it keeps its markers.
+  void _close(int index) {
+    Open open = _opened[index];
+    _depth = index;
+    memmove(_hold + open.start, _hold + open.start + open.length, _held - open.start - open.length);
+    _held -= open.length;
+    if (_depth == 0) _release();
+  }
+
+  // The marker turned out to be text: keep it and everything opened after it.
+  void _abandon(int index) {
+    _depth = index;
+    if (_depth == 0) _release();
+  }
+
+  void _startRun(char c) {
+    _run = c;
+    _runLength = 1;
+    _runAtLineStart = _lineStart;
+  }
+
+  // Code is passed through unchanged, up to a backtick run as long as the opening one (or the end of the line).
+  void _codeSpan(char c) {
+    if (c == '`') {
+      _ticks++;
+      _emit(c);
+      return;
+    }
+    bool closed = _ticks == _codeLength;
+    _ticks = 0;
+    if (closed || c == '\n') {
+      _state = TEXT;
+      push(c);
+      return;
+    }
+    _emit(c);
+  }
+
+  // A fence ends with a line of at least as many backticks as it opened with.
+  void _fence(char c) {
+    _emit(c);
+    if (c == '\n') {
+      if (_ticks >= _codeLength) _state = TEXT;
+      _ticks = 0;
+      _tickLine = true;
+    } else if (c == '`' && _tickLine) {
+      _ticks++;
+    } else if (!_isSpace(c)) {
+      _ticks = 0;
+      _tickLine = false;
+    } else if (_ticks > 0) {
+      _tickLine = false;
+    }
+  }
+
+  // `*`, `_` and `~~` only open before and close after a non-space (`_` not inside a word, for snake_case), so
+  // "2 * 3" stays as it is. An opened run is held until the same run closes it; "2*3" never does.
+  bool _emphasis(char run, uint8_t length, char next) {
+    if (run == '*' && _runAtLineStart && length == 1 && next == ' ') return true; // Bullet.
+    if (run != '~' && _runAtLineStart && length >= 3 && next == '\n') return false; // Horizontal rule.
+    bool inWord = run == '_';
+    bool canClose = !_isSpace(_prev) && !(inWord && _isWord(next));
+    bool canOpen = !_isSpace(next) && !(inWord && _isWord(_prev));
+    if (run != '~' || length == 2) {
+      int index = canClose ? _find(run, length) : -1;
+      if (index >= 0) {
+        _close(index);
+        return false;
+      }
+      if (canOpen && _open(run, length)) {
+        return false;
+      }
+    }
+    _emitRun(run, length);
+    return false;
+  }
+
+  // Decides what the pending marker run was, now that `next` follows it. True if `next` was consumed too.
+  bool _resolve(char next) {
+    char run = _run;
+    uint8_t length = _runLength;
+    _run = 0;
+    switch (run) {
+      case '*':
+      case '_':
+      case '~':
+        return _emphasis(run, length, next);
+      case '`':
+        _emitRun(run, length);
+        _state = (length >= 3 && _runAtLineStart) ? FENCE : CODE_SPAN;
+        _codeLength = length;
+        _ticks = 0;
+        _tickLine = false;
+        push(next);
+        return true;
+      case '#':
+      case '>':
+        if (next == ' ') return true;
+        _emitRun(run, length);
+        return false;
+      case '-':
+      case '+':
+        if (length == 1 && next == ' ') return true;
+        if (run == '-' && length >= 3 && next == '\n') return false;  // Horizontal rule.
+        _emitRun(run, length);
+        return false;
+      case '!':
+        if (next == '[') {
+          _image = true;
+        } else {
+          _emit(run);
+        }
+        return false;
+      case ']': {
+        int index = _find('[', 0);
+        if (index >= 0 && next == '(') {                               // [text](url): keep the text only.
+          _close(index);
+          _state = LINK_URL;
+          _parens = 0;
+          return true;
+        }
+        if (index >= 0) _abandon(index);
+        _emit(run);
+        return false;
+      }
+      case '\\':
+        if (ispunct((uint8_t)next)) {
+          _emit(next);
+          return true;
+        }
+        _emit(run);
+        return false;
+    }
+    return false;
+  }
+};
+
+class SentenceSegmenter {
+public:
+  SentenceSegmenter(std::function<void(const char*, size_t)> onSentence) : _onSentence(onSentence) {}
+
+  void push(char c) {
+    bool space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    if (_boundary) {
+      _boundary = false;
+      if (space) {
+        _emit(_length);
+        return;
+      }
+    }
+    if (c == '\n') {
+      _emit(_length);
+      return;
+    }
+    if (space && _length == 0) {
+      return;
+    }
+    if (_length == SENTENCE_BUFFER_SIZE) {
+      _split(c);
+    }
+    _buffer[_length++] = c;
+    if (c == '.' || c == '!' || c == '?') {
+      _boundary = c != '.' || !_isListNumber();
+    } else if ((c == '"' || c == '\'' || c == ')') && _length > 1 && _isOneOf(_buffer[_length - 2], ".!?")) {
+      _boundary = true;
+    } else if (_length >= 3 && _isWideTerminator(_buffer + _length - 3)) {
+      _emit(_length);
+    }
+  }
+
+  // Emits whatever is left. Call once at the end of the answer.
+  void finish() {
+    _boundary = false;
+    _emit(_length);
+  }
+
+private:
+  std::function<void(const char*, size_t)> _onSentence;
+  char _buffer[SENTENCE_BUFFER_SIZE + 1];
+  size_t _length = 0;
+  bool _boundary = false;
+
+  static bool _isOneOf(char c, const char* set) {
+    return c != '\0' && strchr(set, c) != nullptr;
+  }
+
+  // 。！？
+  static bool _isWideTerminator(const char* p) {
+    const uint8_t* u = (const uint8_t*)p;
+    return (u[0] == 0xE3 && u[1] == 0x80 && u[2] == 0x82) ||
+           (u[0] == 0xEF && u[1] == 0xBC && (u[2] == 0x81 || u[2] == 0x9F));
+  }
+
+  // "1." at the start of a list item is not the end of a sentence.
+  bool _isListNumber() {
+    if (_length < 2 || _length > 4) return false;
+    for (size_t i = 0; i + 1 < _length; i++) {
+      if (!isdigit((uint8_t)_buffer[i])) return false;
+    }
+    return true;
+  }
+
+  // Hands out the first `length` bytes (trailing spaces trimmed) and keeps the rest.
+  void _emit(size_t length) {
+    size_t end = length;
+    while (end > 0 && _buffer[end - 1] == ' ') end--;
+    if (end > 0) {
+      char saved = _buffer[end];
+      _buffer[end] = '\0';
+      _onSentence(_buffer, end);
+      _buffer[end] = saved;
+    }
+    while (length < _length && _buffer[length] == ' ') length++;
+    memmove(_buffer, _buffer + length, _length - length);
+    _length -= length;
+  }
+
+  // The buffer is full (`next` is about to be added): emit up to the last clause boundary, else the last
+  // space, else the last whole UTF-8 character.
+  void _split(char next) {
+    size_t cut = 0;
+    for (size_t i = _length; i > 1 && cut == 0; i--) {
+      if (_buffer[i - 1] == ' ' && _isOneOf(_buffer[i - 2], ",;:")) cut = i;
+    }
+    for (size_t i = _length; i > 1 && cut == 0; i--) {
+      if (_buffer[i - 1] == ' ') cut = i;
+    }
+    if (cut == 0) {
+      cut = _length;
+      while (cut > 1 && ((uint8_t)(cut < _length ? _buffer[cut] : next) & 0xC0) == 0x80) cut--;
+    }
+    _emit(cut);
+  }
+};
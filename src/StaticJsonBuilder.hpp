@@ -14,10 +14,14 @@
  * - Support for strings, integers, floats, booleans, null, and arrays
  * - Safe for very low-RAM devices like ESP8266
  * - Simple macro wrappers to manage JSON structure
+ * - Single-pass, word-at-a-time string escaping (see JsonStringEncoder.hpp), including control characters
+ * - Strings can be assembled from several pieces (beginString/appendString/endString) without concatenation
+ * - Nesting depth is a template parameter (BasicStaticJsonBuilder<Depth>); StaticJsonBuilder uses JSON_MAX_DEPTH.
+ *   Nesting deeper than that marks the output as overflowed() instead of silently breaking the commas.
  *
  * MIT License
  * Created by zacode123, 18-07-2025
- * Version 2.2.0 (Improved user simplicity)
+ * Version 2.4.1 (Compile-time nesting depth)
  */
 
 #pragma once
@@ -25,33 +29,44 @@
 #include <WString.h>
 #include <cstring>
 #include <cstdio>
+#include "JsonStringEncoder.hpp"
 
 #ifndef JSON_MAX_DEPTH
 #define JSON_MAX_DEPTH 10
 #endif
 
-class StaticJsonBuilder {
+template <int MaxDepth>
+class BasicStaticJsonBuilder {
+  static_assert(MaxDepth > 1, "JSON depth must allow at least one nested object");
+
   char* buffer;
   size_t capacity;
   size_t length;
-  bool isFirst[JSON_MAX_DEPTH];
+  bool isFirst[MaxDepth];
   int depth;
+  int excess = 0;  // Levels opened beyond MaxDepth, they have no comma state.
+  bool truncated = false;
+
+  struct Sink {
+    BasicStaticJsonBuilder& builder;
+    void write(const char* s, size_t n) { builder.writeRaw(s, n); }
+  };
 
 public:
-  StaticJsonBuilder(char* buf, size_t cap, bool = false)
+  BasicStaticJsonBuilder(char* buf, size_t cap, bool = false)
     : buffer(buf), capacity(cap), length(0), depth(0) {
     buffer[0] = '\0';
-    for (int i = 0; i < JSON_MAX_DEPTH; i++) isFirst[i] = true;
+    for (int i = 0; i < MaxDepth; i++) isFirst[i] = true;
   }
 
   void beginObject() {
     writeSeparator();
     writeChar('{');
-    if (depth < JSON_MAX_DEPTH) isFirst[depth++] = true;
+    push();
   }
 
   void endObject() {
-    if (depth > 0) depth--;
+    pop();
     writeChar('}');
     isFirst[depth] = false;
   }
@@ -59,30 +74,56 @@ public:
   void beginArray() {
     writeSeparator();
     writeChar('[');
-    if (depth < JSON_MAX_DEPTH) isFirst[depth++] = true;
+    push();
   }
 
   void endArray() {
-    if (depth > 0) depth--;
+    pop();
     writeChar(']');
     isFirst[depth] = false;
   }
 
   void key(const char* k) {
     writeSeparator();
-    serializeString(k);
+    serializeString(k, strlen(k));
     writeChar(':');
     isFirst[depth] = true;
   }
 
   void value(const char* v) {
     writeSeparator();
-    serializeString(v);
+    serializeString(v, strlen(v));
     isFirst[depth] = false;
   }
 
   void value(const String& v) {
-    value(v.c_str());
+    writeSeparator();
+    serializeString(v.c_str(), v.length());
+    isFirst[depth] = false;
+  }
+
+  // A string value written in several pieces, e.g. an instruction followed by a suffix.
+  void beginString() {
+    writeSeparator();
+    writeChar('"');
+  }
+
+  void appendString(const char* s, size_t n) {
+    Sink sink{*this};
+    JsonStringEncoder::encode(sink, s, n);
+  }
+
+  void appendString(const char* s) {
+    appendString(s, strlen(s));
+  }
+
+  void appendString(const String& s) {
+    appendString(s.c_str(), s.length());
+  }
+
+  void endString() {
+    writeChar('"');
+    isFirst[depth] = false;
   }
 
   void value(int v) {
@@ -108,15 +149,46 @@ public:
   }
 
   const char* c_str() const { return buffer; }
+  size_t size() const { return length; }
+  bool overflowed() const { return truncated; }
 
 private:
+  void push() {
+    if (depth < MaxDepth - 1) {
+      isFirst[++depth] = true;
+    } else {
+      excess++;
+      truncated = true;
+    }
+  }
+
+  void pop() {
+    if (excess > 0) {
+      excess--;
+    } else if (depth > 0) {
+      depth--;
+    }
+  }
+
   void writeChar(char c) {
     if (length + 1 < capacity) {
       buffer[length++] = c;
       buffer[length] = '\0';
+    } else {
+      truncated = true;
     }
   }
 
+  void writeRaw(const char* s, size_t n) {
+    if (length + n >= capacity) {
+      truncated = true;
+      n = capacity - length - 1;
+    }
+    memcpy(buffer + length, s, n);
+    length += n;
+    buffer[length] = '\0';
+  }
+
   void writeLiteral(const char* s) {
     while (*s) writeChar(*s++);
   }
@@ -129,19 +201,11 @@ private:
     }
   }
 
-  void serializeString(const char* s) {
+  void serializeString(const char* s, size_t n) {
     writeChar('"');
-    while (*s) {
-      char c = *s++;
-      switch (c) {
-        case '\"': writeLiteral("\\\""); break;
-        case '\\': writeLiteral("\\\\"); break;
-        case '\n': writeLiteral("\\n"); break;
-        case '\r': writeLiteral("\\r"); break;
-        case '\t': writeLiteral("\\t"); break;
-        default: writeChar(c); break;
-      }
-    }
+    appendString(s, n);
     writeChar('"');
   }
-};
\ No newline at end of file
+};
+
+typedef BasicStaticJsonBuilder<JSON_MAX_DEPTH> StaticJsonBuilder;
@@ -22,9 +22,26 @@
  * furnished to do so, subject to the following conditions:
  *
  * Created by zacode123, 16-07-2025
- * Version 2.5.0 (Corrected Recursive Search Logic)
+ * Version 2.9.0 (Batch skipping)
  *
  * CHANGELOG:
+ * - v2.9.0 (19-10-2026):
+ * - Skipped strings, objects and arrays are consumed a whole available() batch at a time with one
+ * read() per byte, instead of a deadline check, an available() and a read() per byte.
+ * - The internals are protected, so readers for a known document shape (ResponseEventReader) can
+ * build on the same deadlines and skipping.
+ * - v2.8.0 (19-10-2026):
+ * - The key search is iterative with an explicit 1-bit-per-level stack and a configurable maximum
+ * depth (deeper containers are skipped, not descended into), so a hostile response can no longer
+ * overflow the call stack. Every byte is consumed in O(1) and malformed input ends the search.
+ * - Every wait for data has an idle deadline (no new byte) and a total deadline (since the parser
+ * was created). A stalled stream ends the value and sets timedOut() instead of hanging forever.
+ * - v2.7.0 (19-10-2026):
+ * - Keys are compared with the searched key while they are read, instead of
+ * being collected into a String first. \u escapes no longer allocate.
+ * - v2.6.0 (19-10-2026):
+ * - Added getFloatArray() to stream the numbers of an array (e.g. embedding
+ * "values") to a callback one at a time without building a String.
  * - v2.5.0 (19-07-2025):
  * - CRITICAL FIX: Rewrote the _findKeyRecursive function to correctly search
  * inside nested objects and arrays instead of incorrectly skipping them.
@@ -42,14 +59,34 @@
 #include <ctype.h>
 #include <functional>
 
+// Containers nested deeper than this are skipped by find(). At most 255.
+#ifndef JSON_PARSER_MAX_DEPTH
+#define JSON_PARSER_MAX_DEPTH 32
+#endif
+
+// Longest time to wait for the next byte, and for the whole response (both in ms).
+#ifndef JSON_PARSER_IDLE_TIMEOUT
+#define JSON_PARSER_IDLE_TIMEOUT 10000
+#endif
+
+#ifndef JSON_PARSER_TOTAL_TIMEOUT
+#define JSON_PARSER_TOTAL_TIMEOUT 60000
+#endif
+
 class StreamJsonParser {
 public:
-  StreamJsonParser(Stream &stream) : _stream(stream), _peek('\0') {}
+  StreamJsonParser(Stream &stream, uint8_t maxDepth = JSON_PARSER_MAX_DEPTH,
+                   uint32_t idleTimeout = JSON_PARSER_IDLE_TIMEOUT, uint32_t totalTimeout = JSON_PARSER_TOTAL_TIMEOUT)
+    : _stream(stream), _peek('\0'), _maxDepth(maxDepth), _idleTimeout(idleTimeout), _totalTimeout(totalTimeout),
+      _start(millis()) {}
+
+  // True once a wait for data ran into the idle or total deadline; every later read gives up immediately.
+  bool timedOut() const { return _timedOut; }
 
   bool find(const char *key) {
     _peek = '\0';
     _skipWhitespace();
-    while (_stream.available()) {
+    while (_waitForData()) {
       char c = _stream.peek();
       if (c == '{' || c == '[') break;
       _stream.read();
@@ -58,7 +95,7 @@ public:
     if (first_char != '{' && first_char != '[') {
       return false;
     }
-    return _findKeyRecursive(key);
+    return _findKey(key);
   }
   
   void getValueStream(std::function<void(char)> onChar) {
@@ -67,11 +104,11 @@ public:
     if (c == '"') {
       _read();
       while (true) {
-        while (!_stream.available()) delay(1);
+        if (!_waitForData()) break;
         char ch = _read();
         if (ch == '"') break;
         if (ch == '\\') {
-          while (!_stream.available()) delay(1);
+          if (!_waitForData()) break;
             char next = _read();
             switch (next) {
               case '"': onChar('"'); break;
@@ -83,26 +120,20 @@ public:
               case 'r': onChar('\r'); break;
               case 't': onChar('\t'); break;
               case 'u': {
-                 String hex1;
-                 if (!hex1.reserve(5)) {
-                    Serial.println(F("Error: Failed to reserve 5b for hex1 in 'getValueStream()'!"));
-                 }
-                 for (int i = 0; i < 4; ++i) {
-                    hex1 += (char)_read();
+                 char hex1[5] = {0};
+                 for (int i = 0; i < 4 && _waitForData(); ++i) {
+                    hex1[i] = _read();
                  }
-                 uint16_t cp1 = strtol(hex1.c_str(), nullptr, 16);
-                 if (cp1 >= 0xD800 && cp1 <= 0xDBFF && _stream.peek() == '\\') {
+                 uint16_t cp1 = strtol(hex1, nullptr, 16);
+                 if (cp1 >= 0xD800 && cp1 <= 0xDBFF && _waitForData() && _stream.peek() == '\\') {
                     _read();
-                    if (_stream.peek() == 'u') {
+                    if (_waitForData() && _stream.peek() == 'u') {
                         _read();
-                        String hex2;
-                        if (!hex2.reserve(5)) {
-                           Serial.println(F("Error: Failed to reserve 5b for hex2 in 'getValueStream()'!"));
+                        char hex2[5] = {0};
+                        for (int i = 0; i < 4 && _waitForData(); ++i) {
+                           hex2[i] = _read();
                         }
-                        for (int i = 0; i < 4; ++i) {
-                           hex2 += (char)_read();
-                        }
-                       uint16_t cp2 = strtol(hex2.c_str(), nullptr, 16);
+                       uint16_t cp2 = strtol(hex2, nullptr, 16);
                        if (cp2 >= 0xDC00 && cp2 <= 0xDFFF) {
                            uint32_t full = 0x10000 + ((cp1 - 0xD800) << 10) + (cp2 - 0xDC00);
                            onChar((char)(0xF0 | ((full >> 18) & 0x07)));
@@ -132,7 +163,7 @@ public:
         }
       }
     } else if (isdigit(c) || c == '-') {
-      while (_stream.available()) {
+      while (_waitForData()) {
         char current_char = _stream.peek();
         if (isdigit(current_char) || current_char == '.' || current_char == '-' || current_char == '+' || current_char == 'e' || current_char == 'E') {
           onChar(_read());
@@ -143,7 +174,7 @@ public:
     } else if (c == '{' || c == '[') {
       int balance = 0;
       do {
-        while (!_stream.available()) delay(1);
+        if (!_waitForData()) break;
         char ch = _read();
         onChar(ch);
         if (ch == '{' || ch == '[') balance++;
@@ -154,9 +185,62 @@ public:
     }
   }
 
-private:
+  size_t getFloatArray(std::function<void(float)> onValue) {
+    _skipWhitespace();
+    if (_stream.peek() != '[') {
+      _skipValue();
+      return 0;
+    }
+    _read();
+    size_t count = 0;
+    char number[32];
+    uint8_t length = 0;
+    while (true) {
+      if (!_waitForData()) break;
+      char c = _read();
+      if (isdigit(c) || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E') {
+        if (length < sizeof(number) - 1) number[length++] = c;
+        continue;
+      }
+      if (length > 0) {
+        number[length] = '\0';
+        onValue(strtof(number, nullptr));
+        length = 0;
+        count++;
+      }
+      if (c == ']') break;
+    }
+    return count;
+  }
+
+protected:
   Stream &_stream;
   char _peek;
+  uint8_t _maxDepth;
+  uint32_t _idleTimeout;
+  uint32_t _totalTimeout;
+  unsigned long _start;
+  bool _timedOut = false;
+
+  bool _waitForData() {
+    if (_peek != '\0') {
+      return true;
+    }
+    unsigned long idleStart = millis();
+    while (_stream.available() <= 0 || _timedOut) {
+      unsigned long now = millis();
+      if (_timedOut || now - idleStart >= _idleTimeout || now - _start >= _totalTimeout) {
+        _timedOut = true;
+        return false;
+      }
+      delay(1);
+    }
+    if (millis() - _start >= _totalTimeout) {
+      _timedOut = true;
+      return false;
+    }
+    return true;
+  }
   char _read() {
     if (_peek != '\0') {
       char p = _peek;
@@ -170,7 +254,7 @@ private:
   }
 
   void _skipWhitespace() {
-    while (_stream.available()) {
+    while (_waitForData()) {
       int c = _stream.peek();
       if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
         _stream.read();
@@ -182,11 +266,47 @@ private:
 
   void _skipString() {
       _read();
-      while(_stream.available()){
-          char c = _read();
-          if(c == '"') break;
-          if(c == '\\') _read();
+      _skipStringBody();
+  }
+
+  // The opening quote is already consumed.
+  void _skipStringBody() {
+      _skipRaw(0, true);
+  }
+
+  // Skips the rest of a string (`inString`) or of `depth` open containers. Every batch the stream reports
+  // as available is consumed in one tight loop; deadlines are only checked between batches.
+  void _skipRaw(int depth, bool inString) {
+    bool escaped = false;
+    auto step = [&](char c) {
+      if (inString) {
+        if (escaped) {
+          escaped = false;
+        } else if (c == '\\') {
+          escaped = true;
+        } else if (c == '"') {
+          inString = false;
+          return depth == 0;
+        }
+      } else if (c == '"') {
+        inString = true;
+      } else if (c == '{' || c == '[') {
+        depth++;
+      } else if (c == '}' || c == ']') {
+        return --depth == 0;
+      }
+      return false;
+    };
+    if (_peek != '\0' && step(_read())) {
+      return;
+    }
+    while (_waitForData()) {
+      for (int n = _stream.available(); n > 0; n--) {
+        int c = _stream.read();
+        if (c < 0) break;
+        if (step(c)) return;
       }
+    }
   }
 
   void _skipValue() {
@@ -199,7 +319,7 @@ private:
     } else if (c == '[') {
       _skipArray();
     } else if (isdigit(c) || c == '-' || c == 't' || c == 'f' || c == 'n') {
-      while (_stream.available()) {
+      while (_waitForData()) {
         char current_char = _stream.peek();
         if (strchr(" \t\n\r,}]", current_char) == NULL) {
             _read();
@@ -212,93 +332,92 @@ private:
 
   void _skipObject() {
     _read();
-    int balance = 1;
-    while (_stream.available() && balance > 0) {
-      char c = _read();
-      if (c == '{') balance++;
-      else if (c == '}') balance--;
-      else if (c == '"') _skipString();
-    }
+    _skipRaw(1, false);
   }
 
   void _skipArray() {
     _read();
-    int balance = 1;
-    while (_stream.available() && balance > 0) {
-      char c = _read();
-      if (c == '[') balance++;
-      else if (c == ']') balance--;
-      else if (c == '"') _skipString();
-    }
+    _skipRaw(1, false);
   }
 
-  String _parseString() {
-    String result;
-    if (!result.reserve(32)) {
-      Serial.println(F("Error: Failed to reserve 32b for result in '_parseString()'!"));
-    }
-    while (_stream.available()) {
+  // Consumes a key (opening quote already read) and compares it with `key` on the fly, without buffering it.
+  bool _matchKey(const char *key) {
+    size_t matched = 0;
+    bool match = true;
+    while (_waitForData()) {
       char c = _read();
       if (c == '"') break;
-      result += c;
+      if (c == '\\' && _waitForData()) c = _read();
+      if (match && key[matched] == c) {
+        matched++;
+      } else {
+        match = false;
+      }
     }
-    return result;
+    return match && key[matched] == '\0';
   }
 
-  bool _findKeyRecursive(const char *key_to_find) {
-    _skipWhitespace();
-    char current_char = _stream.peek();
-    if (current_char == '{') {
-      _read();
-      while (true) {
-        _skipWhitespace();
-        current_char = _stream.peek();
-        if (current_char == '}') {
-          _read();
-          return false;
-        }
-        if (current_char == ',') {
-          _read();
-          _skipWhitespace();
-        }
-        if (_stream.peek() != '"') return false;
+  // Depth-first search for `key` through the container at the current position. Every iteration consumes
+  // at least one byte or returns, and the only state is one bit per open container.
+  bool _findKey(const char *key) {
+    enum : uint8_t { VALUE, KEY, NEXT } state = VALUE;
+    uint8_t arrays[32] = {0};
+    uint8_t depth = 0;
+    while (true) {
+      _skipWhitespace();
+      if (!_waitForData()) {
+        return false;
+      }
+      int c = _stream.peek();
+      bool inArray = depth > 0 && (arrays[(depth - 1) >> 3] & (1 << ((depth - 1) & 7)));
+      if (state == KEY && c == '"') {
         _read();
-        String currentKey = _parseString();
+        bool match = _matchKey(key);
         _skipWhitespace();
         if (_read() != ':') return false;
-        if (strcmp(currentKey.c_str(), key_to_find) == 0) {
-          return true;
+        if (match) return true;
+        state = VALUE;
+        continue;
+      }
+      if (state == VALUE && (c == '{' || c == '[')) {
+        if (depth >= _maxDepth) {
+          _skipValue();
+          if (depth == 0) return false;
+          state = NEXT;
+          continue;
         }
-        _skipWhitespace();
-        current_char = _stream.peek();
-        if (current_char == '{' || current_char == '[') {
-          if (_findKeyRecursive(key_to_find)) {
-            return true;
-          }
+        _read();
+        if (c == '[') {
+          arrays[depth >> 3] |= 1 << (depth & 7);
         } else {
-          _skipValue();
+          arrays[depth >> 3] &= ~(1 << (depth & 7));
         }
+        depth++;
+        state = c == '[' ? VALUE : KEY;
+        continue;
       }
-    } else if (current_char == '[') {
-      _read();
-      while (true) {
-        _skipWhitespace();
-        current_char = _stream.peek();
-        if (current_char == ']') {
-          _read();
-          return false;
-        }
-        if (current_char == ',') {
-          _read();
-        }
-        if (_findKeyRecursive(key_to_find)) {
-          return true;
-        } else {
+      if (depth == 0) {
+        return false;
+      }
+      if (state == VALUE && c != ']') {
+        if (c == '"') {
+          _skipString();
+        } else if (isdigit(c) || c == '-' || c == 't' || c == 'f' || c == 'n') {
           _skipValue();
+        } else {
+          return false;
         }
+        state = NEXT;
+      } else if (c == ',' && state == NEXT) {
+        _read();
+        state = inArray ? VALUE : KEY;
+      } else if (c == (inArray ? ']' : '}')) {
+        _read();
+        if (--depth == 0) return false;
+        state = NEXT;
+      } else {
+        return false;
       }
     }
-    _skipValue();
-    return false;
   }
 };
\ No newline at end of file
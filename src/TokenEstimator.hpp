@@ -0,0 +1,113 @@
+/*
+ * TokenEstimator.hpp - Fast on-device estimate of Gemini token counts for ESP8266/ESP32.
+ *
+ * Every byte is weighed by its class, in 1/256 tokens, with weights that follow how Gemini's tokenizer splits
+ * text: a run of ASCII letters is about one token per four letters, every digit is its own token, punctuation
+ * is close to one token, whitespace mostly merges into the next word, and a non-ASCII character costs more the
+ * longer its UTF-8 sequence is (accented Latin, then CJK, then emoji). This takes a few comparisons per byte and
+ * no memory.
+ *
+ * The sum is scaled by a calibration factor that follows the real counts: each calibrate() call (with a
+ * `:countTokens` result, or the promptTokenCount of a response) moves it a quarter of the way to the observed
+ * ratio. The number of answer bytes per output token is tracked the same way from candidatesTokenCount, and is
+ * what turns a free-memory budget into a maxOutputTokens value.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+
+class TokenEstimator {
+public:
+  // Uncalibrated weight of `text`, in 1/256 tokens.
+  static uint32_t weigh(const char* text, size_t length) {
+    uint32_t units = 0;
+    for (size_t i = 0; i < length; i++) {
+      units += _weight((uint8_t)text[i]);
+    }
+    return units;
+  }
+
+  static uint32_t weigh(const char* text) {
+    return text ? weigh(text, strlen(text)) : 0;
+  }
+
+  // Calibrated number of tokens for `units` (see weigh()).
+  uint32_t tokens(uint32_t units) const {
+    return (uint32_t)(((uint64_t)units * _scale + 0xFFFFFF) >> 24);
+  }
+
+  uint32_t estimate(const char* text, size_t length) const {
+    return tokens(weigh(text, length));
+  }
+
+  uint32_t estimate(const char* text) const {
+    return tokens(weigh(text));
+  }
+
+  // Moves the prompt calibration towards a real count for text that weighed `units`.
+  void calibrate(uint32_t units, uint32_t actualTokens) {
+    if (units < MIN_SAMPLE * 256 || actualTokens < MIN_SAMPLE) {
+      return;
+    }
+    uint32_t observed = (uint32_t)std::min<uint64_t>(((uint64_t)actualTokens << 24) / units, MAX_SCALE);
+    _scale = std::max<uint32_t>((3 * _scale + std::max<uint32_t>(observed, MIN_SCALE)) / 4, MIN_SCALE);
+  }
+
+  // Moves the answer calibration towards an answer of `bytes` that cost `actualTokens`.
+  void calibrateOutput(size_t bytes, uint32_t actualTokens) {
+    if (bytes < MIN_SAMPLE || actualTokens < MIN_SAMPLE) {
+      return;
+    }
+    uint32_t observed = std::min<uint32_t>((uint32_t)((bytes << 4) / actualTokens), MAX_BYTES_PER_TOKEN << 4);
+    _bytesPerToken = std::max<uint32_t>((3 * _bytesPerToken + std::max<uint32_t>(observed, 1 << 4)) / 4, 1 << 4);
+  }
+
+  // Answer bytes that `count` output tokens may take, and output tokens that fit in `bytes`.
+  size_t bytesFor(uint32_t count) const {
+    return ((size_t)count * _bytesPerToken + 15) >> 4;
+  }
+
+  uint32_t tokensFor(size_t bytes) const {
+    return (uint32_t)((bytes << 4) / _bytesPerToken);
+  }
+
+  // Tokens per weighed token (1.0 uncalibrated) and answer bytes per output token.
+  float scale() const { return _scale / 65536.0f; }
+  float bytesPerToken() const { return _bytesPerToken / 16.0f; }
+
+  // Restores a calibration saved from scale() and bytesPerToken(), e.g. across deep sleep.
+  void restore(float scale, float bytesPerToken) {
+    _scale = std::min<uint32_t>(std::max<uint32_t>((uint32_t)(scale * 65536.0f), MIN_SCALE), MAX_SCALE);
+    _bytesPerToken = std::min<uint32_t>(std::max<uint32_t>((uint32_t)(bytesPerToken * 16.0f), 1 << 4), MAX_BYTES_PER_TOKEN << 4);
+  }
+
+private:
+  static constexpr uint32_t MIN_SAMPLE = 8;
+  static constexpr uint32_t MIN_SCALE = 1 << 14;  // 0.25
+  static constexpr uint32_t MAX_SCALE = 1 << 18;  // 4.0
+  static constexpr uint32_t MAX_BYTES_PER_TOKEN = 16;
+
+  uint32_t _scale = 1 << 16;          // 16.16 fixed point.
+  uint32_t _bytesPerToken = 4 << 4;   // 12.4 fixed point, answers start at 4 bytes per token.
+
+  static uint16_t _weight(uint8_t c) {
+    if (c >= 0x80) {
+      // Only the first byte of a UTF-8 sequence counts.
+      if (c >= 0xF0) return 512;   // Emoji and other 4-byte characters.
+      if (c >= 0xE0) return 230;   // CJK and the rest of the BMP.
+      if (c >= 0xC0) return 96;    // Accented Latin, Greek, Cyrillic, ...
+      return 0;
+    }
+    if (isalpha(c)) return 58;
+    if (isdigit(c)) return 256;
+    if (c == '\n') return 128;
+    if (c == ' ' || c == '\t' || c == '\r') return 16;
+    return 160;
+  }
+};
@@ -0,0 +1,307 @@
+/*
+ * TrafficCapture.hpp - Record Gemini responses with their arrival timing, and replay them deterministically.
+ *
+ * CaptureStream sits between the socket and the reader and writes every byte that is read, together with the
+ * time it became readable, to any Print (an SD/LittleFS File, or Serial). ReplayStream reads such a capture and
+ * serves it again through the regular Stream interface, either with the original timing or as fast as possible.
+ * Either way the reader sees exactly the original batches (TLS records / TCP segments as the sketch saw them), so
+ * chunk boundaries, split escapes and stalls are reproduced, which makes parser and transport changes measurable
+ * with real response shapes on the host or on the device.
+ *
+ * Capture format (plain text, so it can also be copied from the serial monitor):
+ *
+ *   # response          <- start of a response, timing restarts at 0
+ *   153,12 485454502f31 <- a new batch of 12 bytes, readable 153 ms after the request was sent, followed by its
+ *                          first bytes in hex
+ *   + 2e3120323030      <- continuation of the same batch
+ *
+ * Any other line starting with '#' is a comment. The replayed reader sees a whole batch, continuation lines
+ * included, as one available() window. Captures without the ",<size>" are still read, a line at a time, with
+ * one empty poll before each new batch when replayed fast.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.1.1
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Stream.h>
+
+// Bytes per capture line.
+#define CAPTURE_LINE_BYTES 32
+
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+class CaptureStream : public Stream {
+public:
+  CaptureStream(Stream& source, Print& sink) : _source(source), _sink(sink) {}
+
+  ~CaptureStream() {
+    end();
+  }
+
+  CaptureStream(const CaptureStream&) = delete;
+  CaptureStream& operator=(const CaptureStream&) = delete;
+
+  // Starts a new response; call when the request has been sent.
+  void begin() {
+    end();
+    _sink.print(F("# response\n"));
+    _start = millis();
+    _left = 0;
+  }
+
+  // Writes out the last partial line.
+  void end() {
+    _writeLine();
+  }
+
+  int available() override {
+    int n = _source.available();
+    if (_left == 0 && n > 0) {
+      _writeLine();
+      _newBatch = true;
+      _at = millis() - _start;
+      _left = n;
+      _batch = n;
+    }
+    return n;
+  }
+
+  int peek() override {
+    return _source.peek();
+  }
+
+  int read() override {
+    if (_left == 0) {
+      available();
+    }
+    int c = _source.read();
+    if (c >= 0) {
+      _line[_length++] = c;
+      if (_length == CAPTURE_LINE_BYTES) {
+        _writeLine();
+      }
+      if (_left > 0) _left--;
+    }
+    return c;
+  }
+
+  size_t write(uint8_t c) override {
+    return _source.write(c);
+  }
+
+private:
+  Stream& _source;
+  Print& _sink;
+  unsigned long _start = 0;
+  unsigned long _at = 0;
+  size_t _left = 0;
+  size_t _batch = 0;
+  bool _newBatch = false;
+  uint8_t _line[CAPTURE_LINE_BYTES];
+  uint8_t _length = 0;
+
+  void _writeLine() {
+    if (_length == 0) {
+      return;
+    }
+    static const char hex[] = "0123456789abcdef";
+    char text[24 + 2 * CAPTURE_LINE_BYTES + 1];
+    int n = _newBatch ? snprintf(text, 24, "%lu,%u ", _at, (unsigned)_batch) : snprintf(text, 24, "+ ");
+    for (uint8_t i = 0; i < _length; i++) {
+      text[n++] = hex[_line[i] >> 4];
+      text[n++] = hex[_line[i] & 0x0F];
+    }
+    text[n++] = '\n';
+    _sink.write((const uint8_t*)text, n);
+    _newBatch = false;
+    _length = 0;
+  }
+};
+
+enum ReplayTiming : uint8_t {
+  REPLAY_ORIGINAL, // Every batch becomes readable at the time it originally arrived.
+  REPLAY_FAST      // No waiting: a batch is readable as soon as the one before it has been read.
+};
+
+class ReplayStream : public Stream {
+public:
+  ReplayStream(Stream& capture, ReplayTiming timing = REPLAY_ORIGINAL) : _capture(capture), _timing(timing) {}
+
+  // Moves to the next recorded response and restarts its clock. False when the capture has no more responses.
+  bool nextResponse() {
+    if (!_atMarker) {
+      while (!_skipToMarker()) {
+        if (_eof) return false;
+      }
+    }
+    _atMarker = false;
+    _ended = false;
+    _pos = 0;
+    _length = 0;
+    _batchLeft = 0;
+    _base = millis();
+    return true;
+  }
+
+  // The current response has been fully replayed.
+  bool ended() const {
+    return _ended && _pos >= _length;
+  }
+
+  int available() override {
+    if (_pos >= _length && !_ended) {
+      _stage();
+    }
+    if (_pos >= _length || !_released()) {
+      return 0;
+    }
+    // The rest of the batch is already recorded, so it is all readable now.
+    return std::max(_batchLeft, (size_t)(_length - _pos));
+  }
+
+  int peek() override {
+    return available() ? _buffer[_pos] : -1;
+  }
+
+  int read() override {
+    if (!available()) return -1;
+    _replayed++;
+    if (_batchLeft > 0) _batchLeft--;
+    return _buffer[_pos++];
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+  uint32_t bytesReplayed() const { return _replayed; }
+
+private:
+  Stream& _capture;
+  ReplayTiming _timing;
+  uint8_t _buffer[CAPTURE_LINE_BYTES];
+  uint8_t _pos = 0;
+  uint8_t _length = 0;
+  unsigned long _base = 0;
+  unsigned long _at = 0;
+  size_t _batchLeft = 0; // Bytes of the current batch not read yet, 0 if the capture doesn't say.
+  uint32_t _replayed = 0;
+  bool _gap = false;
+  bool _ended = true;
+  bool _atMarker = false;
+  bool _eof = false;
+
+  bool _released() {
+    if (_gap) {
+      _gap = false;
+      return false;
+    }
+    return _timing == REPLAY_FAST || millis() - _base >= _at;
+  }
+
+  int _next() {
+    int c = _capture.read();
+    if (c < 0) _eof = true;
+    return c;
+  }
+
+  void _skipLine() {
+    int c;
+    while ((c = _next()) >= 0 && c != '\n');
+  }
+
+  // Consumes the rest of a '#' line; true if it was a "# response" marker.
+  bool _readMarker() {
+    static const char marker[] = " response";
+    uint8_t matched = 0;
+    int c;
+    while ((c = _next()) >= 0 && c != '\n') {
+      if (c == '\r') continue;
+      matched = (matched < sizeof(marker) - 1 && c == marker[matched]) ? matched + 1 : 0xFF;
+    }
+    return matched == sizeof(marker) - 1;
+  }
+
+  // Consumes one line; true if it was a "# response" marker.
+  bool _skipToMarker() {
+    int c = _next();
+    if (c == '#') {
+      return _readMarker();
+    }
+    if (c >= 0 && c != '\n') _skipLine();
+    return false;
+  }
+
+  static int8_t _hex(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  // Loads the next line of the current response into the buffer.
+  void _stage() {
+    _pos = 0;
+    _length = 0;
+    while (_length == 0) {
+      int c = _next();
+      if (c < 0) {
+        _ended = true;
+        _batchLeft = 0;
+        return;
+      }
+      if (c == '\n' || c == '\r' || c == ' ') {
+        continue;
+      }
+      if (c == '#') {
+        if (_readMarker()) {
+          _ended = true;
+          _atMarker = true;
+          _batchLeft = 0;
+          return;
+        }
+        continue;
+      }
+      bool newBatch = c != '+';
+      if (newBatch) {
+        unsigned long at = 0;
+        while (c >= '0' && c <= '9') {
+          at = at * 10 + (c - '0');
+          c = _next();
+        }
+        _at = at;
+        _batchLeft = 0;
+        if (c == ',') {
+          c = _next();
+          while (c >= '0' && c <= '9') {
+            _batchLeft = _batchLeft * 10 + (c - '0');
+            c = _next();
+          }
+        }
+        // available() already ends at the batch boundary, so only a capture without sizes needs the empty poll
+        // to show where one batch stops and the next begins.
+        _gap = _timing == REPLAY_FAST && _batchLeft == 0;
+      } else {
+        c = _next();
+      }
+      while (c == ' ') c = _next();
+      while (c >= 0 && c != '\n' && c != '\r') {
+        int8_t high = _hex(c);
+        int low = high < 0 ? c : _next();
+        if (high < 0 || _hex(low) < 0 || _length == CAPTURE_LINE_BYTES) {
+          // Malformed line: keep what was decoded, drop the rest.
+          if (low >= 0 && low != '\n') _skipLine();
+          break;
+        }
+        _buffer[_length++] = (high << 4) | _hex(low);
+        c = _next();
+      }
+    }
+  }
+};
@@ -0,0 +1,476 @@
+/*
+ * WebSocket.hpp - Minimal RFC 6455 WebSocket client framing over an open (TLS) connection for ESP8266/ESP32.
+ *
+ * Nothing is buffered or copied on the way in: WebSocketFrameStream is a Stream over the socket that parses
+ * frame headers as their bytes arrive and unmasks payload bytes one at a time as the reader asks for them, so
+ * StreamJsonParser reads a message straight off the connection. A fragmented message reads as one stream, and
+ * control frames between fragments are handled on the way (pings are answered, a close is echoed); only their
+ * at most 125 payload bytes are held.
+ *
+ * On the way out, WebSocketFrameWriter writes one frame whose length is known up front. A client must mask
+ * what it sends; writeMasked() masks the caller's buffer in place, write() masks through a small stack block.
+ *
+ * WebSocketHandshake upgrades the connection (GET with Upgrade: websocket) and verifies Sec-WebSocket-Accept.
+ *
+ * MIT License
+ * Created by zacode123, 19-10-2026
+ * Version 1.0.0
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Base64.hpp"
+
+// How long the server may take to answer the upgrade request (ms).
+#ifndef WEBSOCKET_HANDSHAKE_TIMEOUT
+#define WEBSOCKET_HANDSHAKE_TIMEOUT 10000
+#endif
+
+// Masks and handshake keys come from the hardware random number generator.
+inline uint32_t webSocketRandom() {
+  #if defined(ESP32)
+    return esp_random();
+  #else
+    return ESP.random();
+  #endif
+}
+
+enum WebSocketOpcode : uint8_t {
+  WS_CONTINUATION = 0x0,
+  WS_TEXT = 0x1,
+  WS_BINARY = 0x2,
+  WS_CLOSE = 0x8,
+  WS_PING = 0x9,
+  WS_PONG = 0xA
+};
+
+// Writes one frame of `length` payload bytes. Writing more than `length` is refused.
+class WebSocketFrameWriter : public Print {
+public:
+  WebSocketFrameWriter(Print& socket, uint8_t opcode, size_t length, bool fin = true) : _socket(socket), _left(length) {
+    uint8_t header[14];
+    size_t size = 2;
+    header[0] = (fin ? 0x80 : 0x00) | (opcode & 0x0F);
+    if (length < 126) {
+      header[1] = 0x80 | length;
+    } else if (length <= 0xFFFF) {
+      header[1] = 0x80 | 126;
+      header[size++] = length >> 8;
+      header[size++] = length;
+    } else {
+      header[1] = 0x80 | 127;
+      for (int shift = 56; shift >= 0; shift -= 8) {
+        header[size++] = shift < 32 ? (uint8_t)((uint32_t)length >> shift) : 0;
+      }
+    }
+    uint32_t mask = webSocketRandom();
+    memcpy(_mask, &mask, 4);
+    memcpy(header + size, _mask, 4);
+    size += 4;
+    _ok = _socket.write(header, size) == size;
+  }
+
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    uint8_t block[64];
+    size_t written = 0;
+    while (written < size) {
+      size_t count = std::min(size - written, sizeof(block));
+      memcpy(block, data + written, count);
+      count = writeMasked(block, count);
+      if (count == 0) {
+        break;
+      }
+      written += count;
+    }
+    return written;
+  }
+
+  // Masks `data` in place (it is changed) and sends it.
+  size_t writeMasked(uint8_t* data, size_t size) {
+    if (!_ok || size > _left) {
+      _ok = false;
+      return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+      data[i] ^= _mask[(_offset + i) & 3];
+    }
+    size_t written = _socket.write(data, size);
+    _offset += written;
+    _left -= written;
+    _ok = written == size;
+    return written;
+  }
+
+  // Nothing failed or was refused so far.
+  bool ok() const {
+    return _ok;
+  }
+
+  // The whole payload was written.
+  bool complete() const {
+    return _ok && _left == 0;
+  }
+
+private:
+  Print& _socket;
+  size_t _left;
+  size_t _offset = 0;
+  uint8_t _mask[4];
+  bool _ok;
+};
+
+// The payload of the data messages on `socket`, one message at a time.
+class WebSocketFrameStream : public Stream {
+public:
+  explicit WebSocketFrameStream(Stream& socket) : _socket(socket) {}
+
+  // Bytes of the current message that can be read now; 0 once it has ended.
+  int available() override {
+    _advance();
+    if (_state != PAYLOAD) {
+      return 0;
+    }
+    int ready = _socket.available();
+    return ready <= 0 ? 0 : (int)std::min<uint32_t>(_left, ready);
+  }
+
+  int read() override {
+    if (available() <= 0) {
+      return -1;
+    }
+    int c = _socket.read();
+    if (c < 0) {
+      return -1;
+    }
+    c ^= _mask[_offset++ & 3];
+    if (--_left == 0) {
+      _state = _fin ? ENDED : HEADER;
+    }
+    return c;
+  }
+
+  int peek() override {
+    if (available() <= 0) {
+      return -1;
+    }
+    int c = _socket.peek();
+    return c < 0 ? -1 : c ^ _mask[_offset & 3];
+  }
+
+  // Frames go out through WebSocketFrameWriter.
+  size_t write(uint8_t) override {
+    return 0;
+  }
+  using Print::write;
+
+  // Discards what is left of the current message (as far as it has arrived) and returns true once the
+  // header of the next data message has been read. Never waits.
+  bool nextMessage() {
+    if (_state == ENDED) {
+      _state = HEADER;
+      _inMessage = false;
+    }
+    if (!_inMessage) {
+      _advance();
+      return _inMessage;
+    }
+    while (_state == PAYLOAD || _state == HEADER) {
+      if (available() <= 0) {
+        return false;
+      }
+      read();
+    }
+    return _state == ENDED && nextMessage();
+  }
+
+  // The current message has been read to its end.
+  bool messageEnded() const {
+    return _state == ENDED;
+  }
+
+  // WS_TEXT or WS_BINARY, for the current message.
+  uint8_t opcode() const {
+    return _opcode;
+  }
+
+  // The server closed the session (or broke the protocol).
+  bool closed() const {
+    return _state == CLOSED;
+  }
+
+  // The status code of the server's close frame, 0 if it had none.
+  uint16_t closeCode() const {
+    return _closeCode;
+  }
+
+  // Sends a close frame; after that only the server's echo is expected.
+  void close(uint16_t code = 1000) {
+    if (_closeSent) {
+      return;
+    }
+    uint8_t status[2] = {(uint8_t)(code >> 8), (uint8_t)code};
+    WebSocketFrameWriter(_socket, WS_CLOSE, 2).writeMasked(status, 2);
+    _closeSent = true;
+  }
+
+  // Starts over for a new connection.
+  void reset() {
+    _state = HEADER;
+    _have = 0;
+    _inMessage = false;
+    _closeSent = false;
+    _closeCode = 0;
+  }
+
+private:
+  enum State : uint8_t { HEADER, PAYLOAD, CONTROL, ENDED, CLOSED };
+
+  Stream& _socket;
+  State _state = HEADER;
+  uint8_t _header[14];
+  uint8_t _have = 0;
+  uint8_t _mask[4] = {0, 0, 0, 0};
+  uint32_t _offset = 0;
+  uint32_t _left = 0;
+  uint8_t _opcode = WS_TEXT;
+  uint8_t _frameOpcode = WS_TEXT;
+  bool _fin = true;
+  bool _inMessage = false;
+  bool _closeSent = false;
+  uint16_t _closeCode = 0;
+  uint8_t _control[125];
+  uint8_t _controlLength = 0;
+
+  // Consumes frame headers and control frames as far as they have arrived, until payload of the current
+  // message is next (or the message has ended).
+  void _advance() {
+    while (_state == HEADER || _state == CONTROL) {
+      if (_socket.available() <= 0) {
+        return;
+      }
+      if (_state == CONTROL) {
+        _readControl();
+      } else if (_readHeader()) {
+        _startFrame();
+      }
+    }
+  }
+
+  // Collects header bytes; true once the header is complete.
+  bool _readHeader() {
+    while (_socket.available() > 0) {
+      _header[_have++] = _socket.read();
+      if (_have >= 2 && _have == _headerSize()) {
+        _have = 0;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint8_t _headerSize() const {
+    uint8_t length = _header[1] & 0x7F;
+    return 2 + (length == 126 ? 2 : length == 127 ? 8 : 0) + (_header[1] & 0x80 ? 4 : 0);
+  }
+
+  void _startFrame() {
+    uint8_t opcode = _header[0] & 0x0F;
+    uint8_t size = _header[1] & 0x7F;
+    uint8_t at = 2;
+    uint64_t length = size;
+    if (size >= 126) {
+      length = 0;
+      for (uint8_t i = 0; i < (size == 126 ? 2 : 8); i++) {
+        length = length << 8 | _header[at++];
+      }
+    }
+    if (_header[1] & 0x80) {
+      memcpy(_mask, _header + at, 4);
+    } else {
+      memset(_mask, 0, 4);
+    }
+    _offset = 0;
+    _fin = _header[0] & 0x80;
+    _frameOpcode = opcode;
+    bool control = opcode & 0x08;
+    // Reserved bits, oversized control frames and fragments out of order end the session.
+    if ((_header[0] & 0x70) || (control && (length > sizeof(_control) || !_fin)) || length > 0xFFFFFFFF
+        || (!control && (opcode == WS_CONTINUATION) != _inMessage) || (!control && opcode > WS_BINARY)) {
+      _state = CLOSED;
+      return;
+    }
+    _left = length;
+    if (control) {
+      _controlLength = 0;
+      _state = CONTROL;
+      if (_left == 0) {
+        _handleControl();
+      }
+      return;
+    }
+    if (!_inMessage) {
+      _inMessage = true;
+      _opcode = opcode;
+    }
+    _state = _left > 0 ? PAYLOAD : _fin ? ENDED : HEADER;
+  }
+
+  void _readControl() {
+    while (_left > 0 && _socket.available() > 0) {
+      _control[_controlLength] = _socket.read() ^ _mask[_controlLength & 3];
+      _controlLength++;
+      _left--;
+    }
+    if (_left == 0) {
+      _handleControl();
+    }
+  }
+
+  void _handleControl() {
+    // Control frames come between frames, the next frame header follows.
+    _state = HEADER;
+    if (_frameOpcode == WS_PING) {
+      WebSocketFrameWriter(_socket, WS_PONG, _controlLength).writeMasked(_control, _controlLength);
+    } else if (_frameOpcode == WS_CLOSE) {
+      _closeCode = _controlLength >= 2 ? _control[0] << 8 | _control[1] : 0;
+      close(_closeCode ? _closeCode : 1000);
+      _state = CLOSED;
+    }
+  }
+};
+
+class WebSocketHandshake {
+public:
+  // Sends the upgrade request for `path` and checks the server's answer. The socket is then at the first frame.
+  static bool perform(Stream& socket, const char* host, const char* path, uint32_t timeout = WEBSOCKET_HANDSHAKE_TIMEOUT) {
+    uint8_t nonce[16];
+    for (uint8_t i = 0; i < sizeof(nonce); i += 4) {
+      uint32_t r = webSocketRandom();
+      memcpy(nonce + i, &r, 4);
+    }
+    char key[25];
+    key[Base64::encode(nonce, sizeof(nonce), key)] = '\0';
+    char expected[29];
+    _accept(key, expected);
+
+    socket.print(F("GET "));
+    socket.print(path);
+    socket.print(F(" HTTP/1.1\r\nHost: "));
+    socket.print(host);
+    socket.print(F("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: "));
+    socket.print(key);
+    socket.print(F("\r\n\r\n"));
+
+    char line[96];
+    bool switching = false;
+    bool upgrade = false;
+    bool accepted = false;
+    unsigned long start = millis();
+    for (uint8_t n = 0; ; n++) {
+      if (!_readLine(socket, line, sizeof(line), start, timeout)) {
+        return false;
+      }
+      if (line[0] == '\0') {
+        break;
+      }
+      if (n == 0) {
+        switching = strncmp(line, "HTTP/1.1 101", 12) == 0;
+      } else if (strncasecmp(line, "Upgrade:", 8) == 0) {
+        const char* value = line + 8;
+        while (*value == ' ') value++;
+        upgrade = strncasecmp(value, "websocket", 9) == 0;
+      } else if (strncasecmp(line, "Sec-WebSocket-Accept:", 21) == 0) {
+        const char* value = line + 21;
+        while (*value == ' ') value++;
+        accepted = strcmp(value, expected) == 0;
+      }
+    }
+    return switching && upgrade && accepted;
+  }
+
+private:
+  // Reads a header line without its line break; a longer line is cut to `size`.
+  static bool _readLine(Stream& socket, char* line, size_t size, unsigned long start, uint32_t timeout) {
+    size_t length = 0;
+    while (millis() - start < timeout) {
+      if (socket.available() <= 0) {
+        delay(1);
+        continue;
+      }
+      char c = socket.read();
+      if (c == '\n') {
+        while (length > 0 && line[length - 1] == '\r') length--;
+        line[length] = '\0';
+        return true;
+      }
+      if (length + 1 < size) {
+        line[length++] = c;
+      }
+    }
+    return false;
+  }
+
+  // base64(SHA-1(key + GUID)), what the server must answer to `key`.
+  static void _accept(const char* key, char* out) {
+    static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t message[64];
+    size_t length = strlen(key);
+    memcpy(message, key, length);
+    memcpy(message + length, guid, sizeof(guid) - 1);
+    length += sizeof(guid) - 1;
+    uint8_t digest[20];
+    _sha1(message, length, digest);
+    out[Base64::encode(digest, sizeof(digest), out)] = '\0';
+  }
+
+  static uint32_t _rotate(uint32_t value, uint8_t bits) {
+    return value << bits | value >> (32 - bits);
+  }
+
+  static void _sha1(const uint8_t* data, size_t length, uint8_t* digest) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint64_t bits = (uint64_t)length * 8;
+    size_t blocks = (length + 8) / 64 + 1;
+    for (size_t block = 0; block < blocks; block++) {
+      uint32_t w[80];
+      for (uint8_t i = 0; i < 64; i++) {
+        size_t at = block * 64 + i;
+        uint8_t byte = at < length ? data[at] : at == length ? 0x80 : 0;
+        if (block == blocks - 1 && i >= 56) {
+          byte = bits >> ((63 - i) * 8);
+        }
+        if ((i & 3) == 0) w[i / 4] = 0;
+        w[i / 4] |= (uint32_t)byte << ((3 - (i & 3)) * 8);
+      }
+      for (uint8_t i = 16; i < 80; i++) {
+        w[i] = _rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+      }
+      uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+      for (uint8_t i = 0; i < 80; i++) {
+        uint32_t f = i < 20 ? ((b & c) | (~b & d)) + 0x5A827999
+                   : i < 40 ? (b ^ c ^ d) + 0x6ED9EBA1
+                   : i < 60 ? ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDC
+                   : (b ^ c ^ d) + 0xCA62C1D6;
+        uint32_t t = _rotate(a, 5) + f + e + w[i];
+        e = d;
+        d = c;
+        c = _rotate(b, 30);
+        b = a;
+        a = t;
+      }
+      h[0] += a;
+      h[1] += b;
+      h[2] += c;
+      h[3] += d;
+      h[4] += e;
+    }
+    for (uint8_t i = 0; i < 20; i++) {
+      digest[i] = h[i / 4] >> ((3 - (i & 3)) * 8);
+    }
+  }
+};
@@ -0,0 +1,45 @@
+// Wall time for N short questions asked one after another against one batch request (mock server). The mock
+// models the fixed cost of every request (connection setup and time to the first byte), not generation time, so
+// the speedup is what short answers gain; long answers are bounded by the model's output rate either way.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+int main() {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(8192);
+  MockServer::connectDelay() = 300;  // TCP and TLS setup on an ESP32.
+  MockServer::latency() = 400;       // Time to the first byte of generateContent for a short prompt.
+  MockServer::bandwidth() = 50;      // Bytes per millisecond.
+
+  const char* answers[] = {"Paris.", "4.", "100 degrees Celsius.", "Jupiter.", "1969.", "Au.", "Seven.", "Leonardo da Vinci."};
+  String questions[] = {"Capital of France?", "2 + 2?", "Boiling point of water in C?", "Largest planet?",
+                        "Year of the first Moon landing?", "Chemical symbol of gold?", "How many continents?",
+                        "Who painted the Mona Lisa?"};
+  printf("%-6s %-10s %10s %10s %8s\n", "count", "keep-alive", "sequential", "batch", "speedup");
+  for (bool keepAlive : {false, true}) {
+    if (keepAlive) {
+      gemini.setKeepAlive(60000);
+    }
+    for (size_t count : {(size_t)2, (size_t)4, (size_t)8}) {
+      for (size_t i = 0; i < count; i++) MockServer::push(httpResponse(answerJson(answers[i])));
+      unsigned long start = millis();
+      for (size_t i = 0; i < count; i++) {
+        assert(gemini.getAnswer(questions[i]) == answers[i]);
+      }
+      unsigned long sequential = millis() - start;
+
+      std::string array = "[";
+      for (size_t i = 0; i < count; i++) array += std::string(i ? "," : "") + "\\\"" + answers[i] + "\\\"";
+      MockServer::push(httpResponse(answerJson(array + "]")));
+      String got[8];
+      start = millis();
+      assert(gemini.getAnswers(questions, got, count) == count);
+      unsigned long batch = millis() - start;
+      for (size_t i = 0; i < count; i++) assert(got[i] == answers[i]);
+      printf("%-6zu %-10s %8lu ms %7lu ms %7.1fx\n", count, keepAlive ? "on" : "off", sequential, batch,
+             (double)sequential / batch);
+    }
+  }
+}
@@ -0,0 +1,93 @@
+// BatchAnswerDemux: escapes, item boundaries and empty items, pushed directly and split across response chunks
+// by Gemini_AI::getAnswersStream().
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+#include <vector>
+
+// JSON string escaping, for the array inside the answer text and again for the answer text itself.
+static std::string escape(const std::string& in) {
+  std::string out;
+  for (char c : in) {
+    if (c == '"' || c == '\\') out += '\\';
+    if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+static std::vector<std::string> demux(const std::string& array, size_t* ended = nullptr) {
+  std::vector<std::string> items;
+  size_t ends = 0;
+  BatchAnswerDemux demux([&](size_t index, char c) {
+    if (items.size() <= index) items.resize(index + 1);
+    items[index] += c;
+  }, [&](size_t index) {
+    if (items.size() <= index) items.resize(index + 1);
+    ends++;
+  });
+  for (char c : array) demux.push(c);
+  assert(demux.done() && demux.completed() == items.size());
+  if (ended) *ended = ends;
+  return items;
+}
+
+int main() {
+  // Every escape, a surrogate pair, an empty item and whitespace between items.
+  const char* array = "[ \"line\\none\\ttab\", \"\" ,\"quote \\\" and \\\\ slash \\/\", \"\\u00e9\\u20AC\\ud83d\\ude00\"]";
+  std::vector<std::string> want = {"line\none\ttab", "", "quote \" and \\ slash /", "é€😀"};
+  size_t ended = 0;
+  assert(demux(array, &ended) == want && ended == want.size());
+
+  // Anything after the closing bracket is ignored.
+  assert(demux("[\"a\"] [\"b\"]") == std::vector<std::string>{"a"});
+
+  // Through Gemini_AI: the array is itself escaped inside the answer text, and chunk boundaries fall inside
+  // both escape levels and between items.
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(4096);
+  String questions[] = {"Tab?", "Nothing?", "Quote?", "Symbols?"};
+  std::string body = answerJson(escape(array));
+  for (size_t chunk : {(size_t)1, (size_t)2, (size_t)3, (size_t)7, body.size()}) {
+    MockServer::push(chunkedResponse(body, chunk));
+    String answers[4];
+    BatchItemStats stats[4];
+    for (auto& s : stats) {
+      s.length = 99;  // Left over from a previous batch.
+      s.firstCharMs = s.totalMs = 12345;
+    }
+    assert(gemini.getAnswers(questions, answers, 4, stats) == 4);
+    for (size_t i = 0; i < 4; i++) {
+      assert(std::string(answers[i].c_str()) == want[i] && stats[i].length == want[i].size());
+      assert(stats[i].firstCharMs <= stats[i].totalMs && stats[i].totalMs < 12345);
+    }
+    assert(stats[1].firstCharMs == 0);
+  }
+  {
+    std::lock_guard<std::mutex> lock(MockServer::m());
+    const std::string& request = MockServer::requests().back();
+    assert(request.find("\"responseSchema\"") != std::string::npos && request.find("\"maxItems\":4") != std::string::npos);
+  }
+
+  // More items than questions are dropped; fewer complete only what arrived.
+  MockServer::push(httpResponse(answerJson(escape("[\"one\",\"two\",\"three\"]"))));
+  String two[2];
+  assert(gemini.getAnswers(questions, two, 2) == 2 && two[0] == "one" && two[1] == "two");
+  MockServer::push(httpResponse(answerJson(escape("[\"one\""))));
+  String cut[2];
+  assert(gemini.getAnswers(questions, cut, 2) == 1 && cut[0] == "one" && cut[1].length() == 0);
+
+  // A batch with tools enabled is refused without a request rather than answered without them.
+  size_t sent = upstreamRequests();
+  gemini.enableGoogleSearch();
+  String refused[2];
+  assert(gemini.getAnswers(questions, refused, 2) == 0 && upstreamRequests() == sent);
+  gemini.disableGoogleSearch();
+  gemini.enableCodeExecution();
+  assert(gemini.getAnswers(questions, refused, 2) == 0 && upstreamRequests() == sent);
+  printf("OK\n");
+}
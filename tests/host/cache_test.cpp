@@ -0,0 +1,100 @@
+// Context caching against the mock server: createCache(), requests naming the cache, refreshCache() by hand and
+// before expiry, recreating a cache that is gone, TTLs longer than millis() can track, and deleteCache().
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+static std::string request(size_t back = 1) {
+  std::lock_guard<std::mutex> lock(MockServer::m());
+  return MockServer::requests()[MockServer::requests().size() - back];
+}
+
+static bool has(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+static std::string created(const std::string& name) {
+  return httpResponse("{\"name\":\"" + name + "\",\"model\":\"models/gemini-2.5-flash-lite\",\"expireTime\":\"2026-10-19T13:00:00Z\"}");
+}
+
+int main() {
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(8192);
+  gemini.setSystemInstruction("You answer questions about the manual.");
+  const char* manual = "Hold the reset button for five seconds.";
+
+  // createCache() uploads the instruction and the document with the TTL, and keeps the returned name.
+  MockServer::push(created("cachedContents/one"));
+  assert(gemini.createCache(manual, 3600) && gemini.getCacheName() == "cachedContents/one");
+  std::string upload = request();
+  assert(has(upload, "POST /v1beta/cachedContents HTTP") && has(upload, "\"ttl\":\"3600s\""));
+  assert(has(upload, "You answer questions about the manual.") && has(upload, manual));
+
+  // Requests name the cache instead of sending the instruction again.
+  MockServer::push(httpResponse(answerJson("Five seconds.")));
+  assert(gemini.getAnswer("How do I reset it?") == "Five seconds.");
+  std::string ask = request();
+  assert(has(ask, "\"cachedContent\":\"cachedContents/one\"") && !has(ask, "systemInstruction"));
+
+  // refreshCache() extends it by the same TTL.
+  MockServer::push(httpResponse("{}"));
+  assert(gemini.refreshCache());
+  std::string patch = request();
+  assert(has(patch, "PATCH /v1beta/cachedContents/one HTTP") && has(patch, "{\"ttl\":\"3600s\"}"));
+
+  // Close to expiry (a quarter of a 4 s TTL before), the next request extends the cache first.
+  MockServer::push(httpResponse("{}"));
+  MockServer::push(created("cachedContents/short"));
+  assert(gemini.createCache(manual, 4));
+  {
+    std::string replaced = request(2);
+    assert(has(replaced, "DELETE /v1beta/cachedContents/one HTTP"));
+  }
+  size_t sent = upstreamRequests();
+  MockServer::push(httpResponse(answerJson("Still cached.")));
+  gemini.getAnswer("Anything else?");
+  assert(upstreamRequests() == sent + 1);
+  delay(3100);
+  MockServer::push(httpResponse("{}"));
+  MockServer::push(httpResponse(answerJson("Extended.")));
+  assert(gemini.getAnswer("Anything else?") == "Extended.");
+  assert(upstreamRequests() == sent + 3 && has(request(2), "PATCH /v1beta/cachedContents/short HTTP"));
+  assert(has(request(), "\"cachedContent\":\"cachedContents/short\""));
+
+  // A cache that can't be extended any more (expired on the server) is created again under a new name.
+  delay(3100);
+  MockServer::push("HTTP/1.1 404 Not Found\r\nContent-Length: 2\r\n\r\n{}");
+  MockServer::push(created("cachedContents/again"));
+  MockServer::push(httpResponse(answerJson("Recreated.")));
+  assert(gemini.getAnswer("And now?") == "Recreated.");
+  assert(gemini.getCacheName() == "cachedContents/again");
+  assert(has(request(2), "POST /v1beta/cachedContents HTTP") && has(request(2), "\"ttl\":\"4s\""));
+  assert(has(request(), "\"cachedContent\":\"cachedContents/again\""));
+
+  // A 60 day TTL is sent as it is; locally the cache is only due after GEMINI_CACHE_RENEW_MAX, not immediately
+  // (on 32 bits 60 days in milliseconds would have wrapped to about 10 days, and over 24.8 days looks overdue).
+  MockServer::push(httpResponse("{}"));
+  MockServer::push(created("cachedContents/long"));
+  assert(gemini.createCache(manual, 60UL * 24 * 3600));
+  assert(has(request(), "\"ttl\":\"5184000s\""));
+  sent = upstreamRequests();
+  for (int i = 0; i < 3; i++) {
+    MockServer::push(httpResponse(answerJson("Long lived.")));
+    gemini.getAnswer("Long?");
+  }
+  assert(upstreamRequests() == sent + 3);
+
+  // deleteCache() removes it on the server, and requests carry the instruction again.
+  MockServer::push(httpResponse("{}"));
+  gemini.deleteCache();
+  assert(has(request(), "DELETE /v1beta/cachedContents/long HTTP") && gemini.getCacheName() == "");
+  MockServer::push(httpResponse(answerJson("Uncached.")));
+  gemini.getAnswer("How do I reset it?");
+  assert(!has(request(), "cachedContent") && has(request(), "systemInstruction"));
+
+  // A failed creation leaves no cache behind.
+  MockServer::push("HTTP/1.1 400 Bad Request\r\nContent-Length: 2\r\n\r\n{}");
+  assert(!gemini.createCache(manual, 3600) && gemini.getCacheName() == "");
+  assert(!gemini.refreshCache());
+  printf("OK\n");
+}
@@ -0,0 +1,99 @@
+// Request coalescing: identical questions from several tasks make one upstream request (RequestCoalescer.hpp).
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Two keys whose 32-bit hashes collide must still run separately.
+static void testHashCollision() {
+  std::unordered_map<uint32_t, std::string> seen;
+  std::string a, b;
+  for (int i = 0; a.empty(); i++) {
+    std::string q = "q" + std::to_string(i);
+    uint32_t hash = RequestKey().add(q.c_str()).value();
+    auto it = seen.find(hash);
+    if (it != seen.end()) {
+      a = it->second;
+      b = q;
+    }
+    seen[hash] = q;
+  }
+  RequestKey ka, kb;
+  ka.add(a.c_str());
+  kb.add(b.c_str());
+  assert(ka.value() == kb.value() && !(ka == kb));
+
+  std::atomic<int> upstream{0};
+  std::string outs[2];
+  auto slow = [&upstream](const char* text) {
+    return [&upstream, text](std::function<void(char)> publish) {
+      upstream++;
+      for (const char* p = text; *p; p++) {
+        publish(*p);
+        delay(5);
+      }
+    };
+  };
+  std::thread first([&] { RequestCoalescer::shared().run(ka, slow("answer A"), [&](char c) { outs[0] += c; }); });
+  delay(5);
+  std::thread second([&] { RequestCoalescer::shared().run(kb, slow("answer B"), [&](char c) { outs[1] += c; }); });
+  first.join();
+  second.join();
+  assert(outs[0] == "answer A" && outs[1] == "answer B" && upstream == 2);
+  printf("hash collision (%s, %s): 2 upstream requests\n", a.c_str(), b.c_str());
+}
+
+// Callers of the same question share one request and each receive the whole streamed answer.
+static void testMockServer() {
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(8192);
+  gemini.enableRequestCoalescing();
+  MockServer::latency() = 100;
+
+  const int callers = 6;
+  std::string text;
+  for (int i = 0; i < 400; i++) text += (char)('a' + i % 26);
+  MockServer::push(chunkedResponse(answerJson(text), 32));
+  size_t before = upstreamRequests();
+  uint32_t coalescedBefore = RequestCoalescer::shared().coalescedCount();
+  std::vector<std::thread> threads;
+  std::string answers[callers], streamed[callers];
+  for (int i = 0; i < callers; i++) {
+    threads.emplace_back([&, i] {
+      delay(i * 5);
+      if (i % 2) {
+        answers[i] = gemini.getAnswer("What is the same?").c_str();
+      } else {
+        gemini.getAnswerStream("What is the same?", [&streamed, i](char c) { streamed[i] += c; });
+        answers[i] = streamed[i];
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  size_t upstream = upstreamRequests() - before;
+  uint32_t coalesced = RequestCoalescer::shared().coalescedCount() - coalescedBefore;
+  for (auto& answer : answers) assert(answer == text);
+  assert(upstream == 1 && coalesced == callers - 1);
+
+  // A different question is not attached to the running one.
+  MockServer::push(httpResponse(answerJson("one")));
+  MockServer::push(httpResponse(answerJson("two")));
+  before = upstreamRequests();
+  String one, two;
+  std::thread a([&] { one = gemini.getAnswer("first"); });
+  std::thread b([&] { two = gemini.getAnswer("second"); });
+  a.join();
+  b.join();
+  assert(upstreamRequests() - before == 2 && one != two);
+  MockServer::latency() = 0;
+  printf("%d callers: %u upstream request, %u coalesced\n", callers, (unsigned)upstream, coalesced);
+}
+
+int main() {
+  testHashCollision();
+  testMockServer();
+  printf("OK\n");
+}
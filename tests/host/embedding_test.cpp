@@ -0,0 +1,161 @@
+// EmbeddingQuantizer at any vector norm, EmbeddingIndex scores and ranking against float cosine similarity, the
+// 16-bit id limit, and vectors quantized straight out of an embedContent response.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+#include <random>
+#include <vector>
+
+static std::mt19937 rng(42);
+
+static std::vector<float> gaussian(size_t dims, float norm) {
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<float> v(dims);
+  double sum = 0;
+  for (float& x : v) {
+    x = dist(rng);
+    sum += x * x;
+  }
+  for (float& x : v) x *= norm / sqrt(sum);
+  return v;
+}
+
+static double cosine(const std::vector<float>& a, const std::vector<float>& b) {
+  double ab = 0, aa = 0, bb = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    ab += a[i] * b[i];
+    aa += a[i] * a[i];
+    bb += b[i] * b[i];
+  }
+  return ab / sqrt(aa * bb);
+}
+
+static float quantize(const std::vector<float>& v, int8_t* out, float* scale = nullptr) {
+  EmbeddingQuantizer quantizer(out, v.size());
+  for (float x : v) quantizer.push(x);
+  quantizer.finish();
+  if (scale) *scale = quantizer.scale();
+  return quantizer.invNorm();
+}
+
+int main() {
+  // Whatever the norm (unit, truncated gemini-embedding-001 vectors well below it, or larger), the largest component
+  // uses the upper half of the int8 range and the quantized vector points where the original did.
+  for (size_t dims : {(size_t)256, (size_t)768, (size_t)1536}) {
+    for (float norm : {1.0f, 0.45f, 0.1f, 0.02f, 3.0f}) {
+      std::vector<float> v = gaussian(dims, norm);
+      std::vector<int8_t> q(dims);
+      float scale = 0;
+      float invNorm = quantize(v, q.data(), &scale);
+      int peak = 0;
+      std::vector<float> back(dims);
+      for (size_t i = 0; i < dims; i++) {
+        peak = std::max(peak, abs(q[i]));
+        back[i] = q[i] / scale;
+        assert(fabsf(back[i] - v[i]) <= 1.0f / scale);
+      }
+      assert(peak >= 64 && peak <= 127);
+      assert(cosine(v, back) > 0.999);
+      // invNorm turns the integer self dot product into 1.
+      double self = EmbeddingIndex::dot(q.data(), q.data(), dims) * (double)invNorm * invNorm;
+      assert(fabs(self - 1.0) < 0.01);
+    }
+  }
+
+  // A short response is zero filled; a zero vector has no direction; values that aren't numbers count as 0.
+  {
+    int8_t q[8];
+    EmbeddingQuantizer quantizer(q, 8);
+    quantizer.push(0.5f);
+    quantizer.push(-0.25f);
+    assert(quantizer.count() == 2);
+    quantizer.finish();
+    assert(quantizer.count() == 8 && q[0] >= 64 && abs(2 * q[1] + q[0]) <= 1 && q[7] == 0);
+    assert(quantize({0, 0, 0, 0}, q) == 0.0f);
+    quantize({NAN, 1.0f, INFINITY, -1.0f}, q);
+    assert(q[0] == 0 && q[1] == 127 && q[2] == 0 && q[3] == -127);
+  }
+
+  // Scores match float cosine similarity, and search() ranks like it: every stored vector has a known cosine
+  // with the query, and its own norm.
+  {
+    const size_t dims = 768, count = 40;
+    std::vector<float> query = gaussian(dims, 0.6f);
+    std::vector<int8_t> vectors(count * dims), q(dims);
+    std::vector<float> norms(count), want(count);
+    EmbeddingIndex index(vectors.data(), norms.data(), count, dims);
+    for (size_t id = 0; id < count; id++) {
+      // Cosine 0.95 - 0.02 * rank, with the ranks shuffled: the query direction plus an orthogonal one.
+      size_t rank = (id * 17) % count;
+      std::vector<float> noise = gaussian(dims, 1.0f);
+      double along = 0, length = 0;
+      for (size_t i = 0; i < dims; i++) along += noise[i] * query[i] / 0.36;
+      for (size_t i = 0; i < dims; i++) {
+        noise[i] -= (float)(along * query[i]);
+        length += noise[i] * noise[i];
+      }
+      length = sqrt(length);
+      double c = 0.95 - 0.02 * rank;
+      std::vector<float> v(dims);
+      for (size_t i = 0; i < dims; i++) {
+        v[i] = (float)(c * query[i] / 0.6 + sqrt(1 - c * c) * noise[i] / length) * (0.05f + 0.05f * id);
+      }
+      want[id] = (float)cosine(query, v);
+      assert(index.add(q.data(), quantize(v, q.data())) == (int)id);
+    }
+    float queryInvNorm = quantize(query, q.data());
+    for (size_t id = 0; id < count; id++) {
+      assert(fabsf(index.score(q.data(), queryInvNorm, id) - want[id]) < 0.01f);
+    }
+    EmbeddingMatch best[5];
+    assert(index.search(q.data(), queryInvNorm, best, 5) == 5);
+    for (size_t r = 0; r < 5; r++) {
+      assert((best[r].id * 17) % count == r);
+      assert(r == 0 || best[r - 1].score >= best[r].score);
+    }
+    EmbeddingMatch all[64];
+    assert(index.search(q.data(), queryInvNorm, all, 64) == count && index.search(q.data(), queryInvNorm, all, 0) == 0);
+    assert(index.score(q.data(), queryInvNorm, count) == 0);
+  }
+
+  // Ids are 16-bit: an index holds at most EMBEDDING_MAX_VECTORS, and the last one is still found.
+  {
+    const size_t capacity = EMBEDDING_MAX_VECTORS + 100;
+    std::vector<int8_t> vectors(capacity * 2);
+    std::vector<float> norms(capacity);
+    EmbeddingIndex index(vectors.data(), norms.data(), capacity, 2);
+    assert(index.capacity() == EMBEDDING_MAX_VECTORS);
+    const int8_t other[2] = {127, 0}, target[2] = {0, 127};
+    for (size_t id = 0; id + 1 < EMBEDDING_MAX_VECTORS; id++) assert(index.add(other, 1.0f / 127) == (int)id);
+    assert(index.add(target, 1.0f / 127) == EMBEDDING_MAX_VECTORS - 1);
+    assert(index.add(target, 1.0f / 127) == -1 && index.nextSlot() == nullptr);
+    EmbeddingMatch best[1];
+    assert(index.search(target, 1.0f / 127, best, 1) == 1 && best[0].id == EMBEDDING_MAX_VECTORS - 1);
+    assert(fabsf(best[0].score - 1.0f) < 1e-4f);
+  }
+
+  // Through Gemini_AI: a truncated, not normalized vector keeps its precision.
+  {
+    Gemini_AI gemini;
+    gemini.setApiKey("KEY");
+    gemini.begin(8192);
+    const size_t dims = 768;
+    std::vector<float> v = gaussian(dims, 0.4f);
+    std::string body = "{\"embedding\":{\"values\":[";
+    for (size_t i = 0; i < dims; i++) {
+      char number[32];
+      snprintf(number, sizeof(number), "%s%.8g", i ? "," : "", v[i]);
+      body += number;
+    }
+    MockServer::push(chunkedResponse(body + "]}}", 61));
+    int8_t vectors[dims];
+    float norms[1];
+    EmbeddingIndex index(vectors, norms, 1, dims);
+    assert(gemini.addEmbedding(index, "turn on the lights") == 0);
+    std::vector<int8_t> q(dims);
+    float invNorm = quantize(v, q.data());
+    assert(memcmp(vectors, q.data(), dims) == 0 && fabsf(norms[0] - invNorm) < 1e-6f * invNorm);
+    assert(fabsf(index.score(q.data(), invNorm, 0) - 1.0f) < 0.01f);
+  }
+  printf("OK\n");
+}
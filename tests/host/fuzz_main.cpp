@@ -0,0 +1,163 @@
+// Standalone driver for the *_fuzz.cpp targets, for builds without libFuzzer. Each target only defines
+// LLVMFuzzerTestOneInput, so it links unchanged against libFuzzer (clang++ -fsanitize=fuzzer,address) or against
+// this file (g++, or afl-g++ for AFL: afl-fuzz -i corpus/json_parser -o findings -- build/json_parser_fuzz @@).
+//
+//   build/x_fuzz                          runs stdin once
+//   build/x_fuzz FILE|DIR...              runs every input once
+//   build/x_fuzz -runs=N [FILE|DIR...]    also runs N random mutations of the inputs
+//
+// -seed=N picks the mutation sequence and -timeout=S (default 2) the seconds one input may take. An input that
+// crashes, fails an assertion or runs out of time is written to crash-<pid> in the current directory.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <signal.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#if defined(__has_include)
+#if __has_include(<sanitizer/common_interface_defs.h>)
+#include <sanitizer/common_interface_defs.h>
+#define FUZZ_HAS_SANITIZER 1
+#endif
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static std::string current;
+
+static void saveCurrent() {
+  char name[32];
+  snprintf(name, sizeof(name), "crash-%d", (int)getpid());
+  if (FILE* f = fopen(name, "wb")) {
+    fwrite(current.data(), 1, current.size(), f);
+    fclose(f);
+    fprintf(stderr, "input written to %s (%zu bytes)\n", name, current.size());
+  }
+}
+
+static void onSignal(int sig) {
+  if (sig == SIGALRM) fprintf(stderr, "timeout\n");
+  saveCurrent();
+  signal(sig, SIG_DFL);
+  raise(sig == SIGALRM ? SIGABRT : sig);
+}
+
+static void run(const std::string& input, unsigned timeout) {
+  current = input;
+  alarm(timeout);
+  // A copy in its own allocation, so reading past the end is caught by the address sanitizer.
+  std::vector<uint8_t> data(input.begin(), input.end());
+  LLVMFuzzerTestOneInput(data.data(), data.size());
+  alarm(0);
+}
+
+static void load(const std::string& path, std::vector<std::string>& inputs) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return;
+  if (S_ISDIR(st.st_mode)) {
+    DIR* dir = opendir(path.c_str());
+    while (dirent* entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') load(path + "/" + entry->d_name, inputs);
+    }
+    closedir(dir);
+    return;
+  }
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream data;
+  data << file.rdbuf();
+  inputs.push_back(data.str());
+}
+
+static std::string mutate(std::string input, const std::vector<std::string>& inputs, std::mt19937& rng) {
+  static const char* tokens[] = {"{", "}", "[", "]", "\"", ":", ",", "\\", "\\u", "\\ud83d", "\"text\"", "-1e9", "null"};
+  for (int edits = 1 + rng() % 4; edits > 0; edits--) {
+    size_t at = input.empty() ? 0 : rng() % (input.size() + 1);
+    switch (rng() % 7) {
+      case 0:
+        if (at < input.size()) input[at] ^= 1 << (rng() % 8);
+        break;
+      case 1:
+        if (at < input.size()) input[at] = (char)rng();
+        break;
+      case 2:
+        input.insert(at, 1 + rng() % 8, (char)rng());
+        break;
+      case 3:
+        input.erase(at, 1 + rng() % 16);
+        break;
+      case 4:
+        input.insert(at, tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))]);
+        break;
+      case 5:
+        if (at < input.size()) input.insert(at, input.substr(at, 1 + rng() % 64));
+        break;
+      default: {
+        const std::string& other = inputs[rng() % inputs.size()];
+        size_t from = other.empty() ? 0 : rng() % other.size();
+        input.insert(at, other.substr(from, 1 + rng() % 256));
+      }
+    }
+  }
+  return input.size() > 65536 ? input.substr(0, 65536) : input;
+}
+
+int main(int argc, char** argv) {
+  long runs = 0;
+  unsigned seed = 1, timeout = 2;
+  std::vector<std::string> inputs;
+  bool anyPath = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "-runs=", 6)) {
+      runs = atol(argv[i] + 6);
+    } else if (!strncmp(argv[i], "-seed=", 6)) {
+      seed = atoi(argv[i] + 6);
+    } else if (!strncmp(argv[i], "-timeout=", 9)) {
+      timeout = atoi(argv[i] + 9);
+    } else {
+      anyPath = true;
+      load(argv[i], inputs);
+    }
+  }
+  signal(SIGALRM, onSignal);
+  signal(SIGABRT, onSignal);
+  signal(SIGSEGV, onSignal);
+#ifdef FUZZ_HAS_SANITIZER
+  __sanitizer_set_death_callback(saveCurrent);
+#endif
+
+  if (!anyPath && runs == 0) {
+    std::stringstream data;
+    data << std::cin.rdbuf();
+    inputs.push_back(data.str());
+  }
+  for (const std::string& input : inputs) {
+    run(input, timeout);
+  }
+  if (inputs.empty()) {
+    inputs.push_back("");
+  }
+  std::mt19937 rng(seed);
+  std::vector<std::string> pool = inputs;
+  for (long i = 0; i < runs; i++) {
+    std::string input = mutate(pool[rng() % pool.size()], pool, rng);
+    run(input, timeout);
+    // Keep some mutants so that edits accumulate, without letting the pool grow unbounded.
+    if (rng() % 8 == 0) {
+      if (pool.size() < 256) {
+        pool.push_back(input);
+      } else if (pool.size() > inputs.size()) {
+        pool[inputs.size() + rng() % (pool.size() - inputs.size())] = input;
+      }
+    }
+  }
+  fprintf(stderr, "%zu inputs, %ld mutations\n", inputs.size(), runs);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Bytes on air and end-to-end latency of a grounded answer, plain and gzip, over a slow link (mock server).
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <zlib.h>
+
+static std::string gzip(const std::string& data) {
+  z_stream z{};
+  deflateInit2(&z, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&z, data.size()), '\0');
+  z.next_in = (Bytef*)data.data();
+  z.avail_in = data.size();
+  z.next_out = (Bytef*)&out[0];
+  z.avail_out = out.size();
+  deflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+// The shape of a Google Search grounded response: a short answer, then the rendered search chip HTML,
+// the sources and the supports, which make up most of the bytes.
+static std::string groundedResponse(std::string& answer) {
+  answer = "The Eiffel Tower is 330 metres tall, about the height of an 81-storey building.";
+  std::string html = "<style>.container{align-items:center;border-radius:8px;display:flex;font-family:Google Sans,Roboto,"
+                     "sans-serif;font-size:14px;line-height:20px;padding:8px 12px;}.chip{display:inline-block;"
+                     "border:solid 1px;border-radius:16px;min-width:14px;padding:5px 16px;text-align:center;}</style>";
+  for (int i = 0; i < 12; i++) {
+    html += "<a class=\\\"chip\\\" href=\\\"https://www.google.com/search?q=eiffel+tower+height+" + std::to_string(i) +
+            "&client=app-vertex-grounding\\\">eiffel tower height " + std::to_string(i) + "</a>";
+  }
+  std::string chunks, supports;
+  for (int i = 0; i < 10; i++) {
+    chunks += std::string(i ? "," : "") + "{\"web\":{\"uri\":\"https://vertexaisearch.cloud.google.com/grounding-api-redirect/AbF9wX" +
+              std::string(120, 'a' + i) + "\",\"title\":\"source" + std::to_string(i) + ".com\"}}";
+    supports += std::string(i ? "," : "") + "{\"segment\":{\"startIndex\":0,\"endIndex\":78,\"text\":\"" + answer +
+                "\"},\"groundingChunkIndices\":[" + std::to_string(i) + "],\"confidenceScores\":[0.9" + std::to_string(i) + "]}";
+  }
+  return "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"" + answer + "\"}],\"role\":\"model\"},"
+         "\"finishReason\":\"STOP\",\"groundingMetadata\":{\"searchEntryPoint\":{\"renderedContent\":\"" + html +
+         "\"},\"groundingChunks\":[" + chunks + "],\"groundingSupports\":[" + supports + "],"
+         "\"webSearchQueries\":[\"eiffel tower height\"]}}],\"usageMetadata\":{\"promptTokenCount\":9,"
+         "\"candidatesTokenCount\":20,\"totalTokenCount\":29},\"modelVersion\":\"gemini-2.0-flash\"}";
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  std::string answer;
+  std::string body = groundedResponse(answer);
+  std::string packed = gzip(body);
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(16384);
+  gemini.setKeepAlive(60000);
+  MockServer::latency() = 60;
+
+  printf("%-10s %8s %10s %10s\n", "link", "encoding", "bytes", "ms");
+  for (int bandwidth : {25, 100}) {  // Bytes per millisecond: a congested 2.4 GHz link and a good one.
+    MockServer::bandwidth() = bandwidth;
+    unsigned long ms[2];
+    size_t bytes[2];
+    for (int compressed = 0; compressed < 2; compressed++) {
+      std::string response = compressed ? httpResponse(packed, "Content-Encoding: gzip\r\n") : httpResponse(body);
+      if (compressed) {
+        gemini.enableCompression();
+      } else {
+        gemini.disableCompression();
+      }
+      const int runs = 5;
+      for (int i = 0; i < runs; i++) MockServer::push(response);
+      unsigned long start = millis();
+      for (int i = 0; i < runs; i++) {
+        String got = gemini.getAnswer("How tall is the Eiffel Tower?");
+        assert(std::string(got.c_str()) == answer);
+      }
+      ms[compressed] = (millis() - start) / runs;
+      bytes[compressed] = response.size();
+      {
+        std::lock_guard<std::mutex> lock(MockServer::m());
+        bool asked = MockServer::requests().back().find("Accept-Encoding: gzip") != std::string::npos;
+        assert(asked == (compressed == 1));
+      }
+      printf("%4d KB/s %8s %10zu %10lu\n", bandwidth, compressed ? "gzip" : "identity", bytes[compressed], ms[compressed]);
+    }
+    printf("%4d KB/s   saved %6.1f%% of the bytes, %6.1f%% of the time\n", bandwidth,
+           100.0 * (bytes[0] - bytes[1]) / bytes[0], 100.0 * ((double)ms[0] - ms[1]) / ms[0]);
+  }
+}
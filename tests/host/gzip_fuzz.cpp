@@ -0,0 +1,28 @@
+// GzipStream on arbitrary bytes. The first byte chooses the window size and how the rest arrives. Decoding must
+// end in finished() or failed() without reading outside the window, and can't inflate faster than deflate's
+// maximum ratio.
+#include <Arduino.h>
+#include <GzipStream.hpp>
+#include <cassert>
+#include <string>
+#include "helpers.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 1) return 0;
+  uint8_t mode = data[0];
+  std::string gz((const char*)data + 1, size - 1);
+
+  TrickleStream source(gz, 1 + (mode & 0x3F) * 4, mode);
+  GzipStream stream(source, GZIP_MIN_WINDOW << (mode >> 6));
+  stream.setTimeouts(0, 1000);
+  size_t out = 0;
+  while (!stream.finished() && !stream.failed()) {
+    while (stream.available()) {
+      stream.read();
+      out++;
+    }
+  }
+  assert(stream.compressedBytes() <= gz.size());
+  assert(out == stream.inflatedBytes() && out <= 1032 * gz.size() + 1032);
+  return 0;
+}
@@ -0,0 +1,121 @@
+// GzipStream against zlib: every block type, window sizes and arbitrary batch boundaries.
+#include "helpers.h"
+#include <GzipStream.hpp>
+#include <zlib.h>
+
+static std::string gzip(const std::string& data, int level, int strategy = Z_DEFAULT_STRATEGY) {
+  z_stream z{};
+  assert(deflateInit2(&z, level, Z_DEFLATED, 15 + 16, 8, strategy) == Z_OK);
+  std::string out(deflateBound(&z, data.size()) + 64, '\0');
+  z.next_in = (Bytef*)data.data();
+  z.avail_in = data.size();
+  z.next_out = (Bytef*)&out[0];
+  z.avail_out = out.size();
+  assert(deflate(&z, Z_FINISH) == Z_STREAM_END);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+static std::string inflate(GzipStream& gz) {
+  std::string out;
+  unsigned long start = millis();
+  while (!gz.finished() && !gz.failed() && millis() - start < 5000) {
+    while (gz.available()) out += (char)gz.read();
+  }
+  return out;
+}
+
+static std::string sampleText(size_t size) {
+  std::string text;
+  for (unsigned i = 0; text.size() < size; i++) {
+    text += "{\"text\":\"word" + std::to_string(i * 7919 % 1000) + " \\u00e9\\n\"},";
+  }
+  text.resize(size);
+  return text;
+}
+
+static std::string randomBytes(size_t size) {
+  std::string data(size, '\0');
+  unsigned seed = 7;
+  for (auto& c : data) {
+    seed = seed * 1103515245 + 12345;
+    c = (char)(seed >> 16);
+  }
+  return data;
+}
+
+int main() {
+  struct Case {
+    const char* name;
+    std::string data;
+    int level;
+    int strategy;
+  };
+  std::string text = sampleText(40000);
+  Case cases[] = {
+    {"empty", "", 6, Z_DEFAULT_STRATEGY},
+    {"stored", text, 0, Z_DEFAULT_STRATEGY},
+    {"fixed", text, 6, Z_FIXED},
+    {"dynamic", text, 9, Z_DEFAULT_STRATEGY},
+    {"huffman only", text, 6, Z_HUFFMAN_ONLY},
+    {"rle", text, 6, Z_RLE},
+    {"random", randomBytes(20000), 9, Z_DEFAULT_STRATEGY},
+  };
+  for (const Case& c : cases) {
+    std::string gz = gzip(c.data, c.level, c.strategy);
+    for (size_t batch : {(size_t)1, (size_t)7, (size_t)1460, gz.size() + 1}) {
+      TrickleStream source(gz, batch);
+      GzipStream stream(source, 32768);
+      std::string out = inflate(stream);
+      assert(stream.finished() && out == c.data);
+      assert(stream.compressedBytes() == gz.size() && stream.inflatedBytes() == c.data.size());
+    }
+    printf("%-13s %6zu -> %6zu bytes\n", c.name, c.data.size(), gz.size());
+  }
+
+  // A smaller window still decodes a response that fits in it, and reports one that doesn't instead of
+  // returning corrupt data.
+  std::string small = sampleText(900);
+  {
+    std::string gz = gzip(small, 9);
+    StringStream source(gz);
+    GzipStream stream(source, 1024);
+    assert(inflate(stream) == small && stream.finished());
+  }
+  {
+    std::string gz = gzip(text, 9);
+    StringStream source(gz);
+    GzipStream stream(source, 1024);
+    std::string out = inflate(stream);
+    assert(stream.failed() && text.compare(0, out.size(), out) == 0);
+  }
+
+  // Corrupt input fails instead of hanging.
+  {
+    std::string gz = gzip(text, 6);
+    gz[gz.size() / 2] ^= 0x55;
+    gz[gz.size() - 6] ^= 0x01;
+    StringStream source(gz);
+    GzipStream stream(source, 32768);
+    inflate(stream);
+    assert(stream.failed());
+  }
+
+  // A truncated response fails once the source stays dry for the idle timeout, after everything before the cut
+  // and not a byte more.
+  for (int level : {0, 9}) {
+    std::string gz = gzip(text, level);
+    for (size_t cut : {(size_t)5, (size_t)12, gz.size() / 2, gz.size() - 3}) {
+      StringStream source(gz.substr(0, cut));
+      GzipStream stream(source, 32768);
+      stream.setTimeouts(50, 400);
+      unsigned long start = millis();
+      std::string out = inflate(stream);
+      unsigned long took = millis() - start;
+      assert(stream.failed() && took >= 50 && took < 200);
+      assert(text.compare(0, out.size(), out) == 0);
+    }
+  }
+  printf("OK\n");
+}
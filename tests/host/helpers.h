@@ -0,0 +1,61 @@
+// Response builders shared by the host tests.
+#pragma once
+
+#include <Arduino.h>
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+inline std::string httpResponse(const std::string& body, const std::string& headers = "") {
+  return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n" + headers + "Content-Length: " + std::to_string(body.size()) +
+         "\r\n\r\n" + body;
+}
+
+inline std::string chunkedResponse(const std::string& body, size_t chunk = 64) {
+  std::string out = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n";
+  for (size_t i = 0; i < body.size(); i += chunk) {
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", std::min(chunk, body.size() - i));
+    out += size + body.substr(i, chunk) + "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+// A generateContent response with one text part (already JSON-escaped).
+inline std::string answerJson(const std::string& text) {
+  return "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"" + text + "\"}]}}],"
+         "\"usageMetadata\":{\"promptTokenCount\":12,\"candidatesTokenCount\":3}}";
+}
+
+inline size_t upstreamRequests() {
+  std::lock_guard<std::mutex> lock(MockServer::m());
+  return MockServer::requests().size();
+}
+
+// Serves `data` in batches of 1..maxBatch bytes, like TLS records arriving one after another.
+class TrickleStream : public Stream {
+ public:
+  TrickleStream(const std::string& data, size_t maxBatch, unsigned seed = 1) : _data(data), _maxBatch(maxBatch), _seed(seed) {}
+
+  int available() override {
+    if (_batch == 0 && _pos < _data.size()) {
+      _seed = _seed * 1103515245 + 12345;
+      _batch = std::min(_data.size() - _pos, (size_t)(1 + (_seed >> 16) % _maxBatch));
+    }
+    return _batch;
+  }
+  int read() override {
+    if (!available()) return -1;
+    _batch--;
+    return (uint8_t)_data[_pos++];
+  }
+  int peek() override { return available() ? (uint8_t)_data[_pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  std::string _data;
+  size_t _maxBatch;
+  unsigned _seed;
+  size_t _pos = 0;
+  size_t _batch = 0;
+};
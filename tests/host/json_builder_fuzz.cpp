@@ -0,0 +1,159 @@
+// StaticJsonBuilder driven by arbitrary bytes, read as a sequence of calls. The output must stay inside the
+// buffer and be terminated, and as long as the builder doesn't report an overflow it must be valid JSON.
+#include <Arduino.h>
+#include <StaticJsonBuilder.hpp>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Strict RFC 8259 check of one value, returns the position after it or npos.
+static size_t validValue(const std::string& s, size_t i, int depth = 0);
+
+static size_t skipSpace(const std::string& s, size_t i) {
+  while (i < s.size() && strchr(" \t\r\n", s[i])) i++;
+  return i;
+}
+
+static size_t validString(const std::string& s, size_t i) {
+  if (i >= s.size() || s[i] != '"') return std::string::npos;
+  for (i++; i < s.size(); i++) {
+    unsigned char c = s[i];
+    if (c == '"') return i + 1;
+    if (c < 0x20) return std::string::npos;
+    if (c == '\\') {
+      if (++i >= s.size()) return std::string::npos;
+      if (s[i] == 'u') {
+        for (int k = 0; k < 4; k++) {
+          if (++i >= s.size() || !isxdigit((unsigned char)s[i])) return std::string::npos;
+        }
+      } else if (!strchr("\"\\/bfnrt", s[i])) {
+        return std::string::npos;
+      }
+    }
+  }
+  return std::string::npos;
+}
+
+static size_t validValue(const std::string& s, size_t i, int depth) {
+  i = skipSpace(s, i);
+  if (i >= s.size() || depth > 64) return std::string::npos;
+  if (s[i] == '"') return validString(s, i);
+  if (s[i] == '{' || s[i] == '[') {
+    char close = s[i] == '{' ? '}' : ']';
+    i = skipSpace(s, i + 1);
+    if (i < s.size() && s[i] == close) return i + 1;
+    while (true) {
+      if (close == '}') {
+        i = validString(s, skipSpace(s, i));
+        if (i == std::string::npos) return i;
+        i = skipSpace(s, i);
+        if (i >= s.size() || s[i] != ':') return std::string::npos;
+        i++;
+      }
+      i = validValue(s, i, depth + 1);
+      if (i == std::string::npos) return i;
+      i = skipSpace(s, i);
+      if (i < s.size() && s[i] == ',') {
+        i++;
+        continue;
+      }
+      return i < s.size() && s[i] == close ? i + 1 : std::string::npos;
+    }
+  }
+  for (const char* literal : {"true", "false", "null"}) {
+    if (s.compare(i, strlen(literal), literal) == 0) return i + strlen(literal);
+  }
+  size_t start = i;
+  if (s[i] == '-') i++;
+  while (i < s.size() && (isdigit((unsigned char)s[i]) || s[i] == '.')) i++;
+  return i > start && isdigit((unsigned char)s[i - 1]) ? i : std::string::npos;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 1) return 0;
+  size_t capacity = 1 + data[0] * 4;
+  std::vector<char> buffer(capacity);
+  BasicStaticJsonBuilder<4> json(buffer.data(), capacity);
+
+  // The calls are only made where they keep the document well formed; the builder is responsible for the
+  // commas, the escaping and for noticing the overflow.
+  std::vector<bool> inObject{false};
+  bool wantValue = true, started = false;
+  size_t i = 1;
+  auto piece = [&](size_t n) {
+    n = std::min(n, size - i);
+    std::string s((const char*)data + i, n);
+    i += n;
+    return s;
+  };
+  auto close = [&]() {
+    if (inObject.back()) json.endObject(); else json.endArray();
+    inObject.pop_back();
+    wantValue = !inObject.back();
+  };
+  while (i < size) {
+    uint8_t op = data[i++];
+    if (inObject.size() == 1 && started) break;
+    if (!wantValue) {
+      // In an object, after '{' or a value: a key or the end of the object.
+      if ((op & 7) == 2) {
+        close();
+        continue;
+      }
+      std::string k = piece(op >> 3);
+      json.key(k.substr(0, k.find('\0')).c_str());
+      wantValue = true;
+      continue;
+    }
+    switch (op & 7) {
+      case 0:
+        json.beginObject();
+        inObject.push_back(true);
+        started = true;
+        wantValue = false;
+        continue;
+      case 1:
+        json.beginArray();
+        inObject.push_back(false);
+        started = true;
+        continue;
+      case 2:
+        if (inObject.size() > 1 && !inObject.back()) close();
+        continue;
+      case 3: {
+        std::string s = piece(op >> 3);
+        json.value(String(s.c_str(), s.size()));
+        break;
+      }
+      case 4:
+        json.beginString();
+        for (int parts = 1 + (op >> 6); parts > 0; parts--) {
+          std::string p = piece((op >> 3) & 7);
+          json.appendString(p.c_str(), p.size());
+        }
+        json.endString();
+        break;
+      case 5:
+        json.value((int)((int8_t)op * 1000003));
+        break;
+      case 6:
+        json.value((op & 8) != 0);
+        break;
+      default:
+        json.value((float)(int8_t)op / 7, op >> 6);
+    }
+    started = true;
+    wantValue = !inObject.back();
+  }
+  while (inObject.size() > 1) {
+    if (inObject.back() && wantValue) json.value(0);
+    close();
+  }
+
+  assert(json.size() < capacity && strlen(json.c_str()) == json.size());
+  if (json.overflowed() || !started) return 0;
+  std::string out = json.c_str();
+  assert(validValue(out, 0) == out.size());
+  return 0;
+}
@@ -0,0 +1,129 @@
+// StaticJsonBuilder: nesting up to the depth limit and one level past it, and every buffer size from too small to
+// just enough, checking overflowed() each time; a Gemini policy whose depth can't hold the payload refuses the request.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+struct Depth5 : DefaultGeminiPolicy {
+  static constexpr int jsonMaxDepth = 5;
+};
+
+struct Depth6 : DefaultGeminiPolicy {
+  static constexpr int jsonMaxDepth = 6;
+};
+
+// Opens `levels` arrays inside each other, with a value first and last on every level.
+template <int Depth>
+static std::string nest(int levels, bool& overflowed) {
+  char buffer[512];
+  BasicStaticJsonBuilder<Depth> builder(buffer, sizeof(buffer));
+  for (int i = 0; i < levels; i++) {
+    builder.beginArray();
+    builder.value(i);
+  }
+  for (int i = 0; i < levels; i++) {
+    builder.value(true);
+    builder.endArray();
+  }
+  overflowed = builder.overflowed();
+  return builder.c_str();
+}
+
+static std::string nested(int levels) {
+  std::string open, close;
+  for (int i = 0; i < levels; i++) {
+    open += (i ? "," : "") + std::string("[") + std::to_string(i);
+    close += ",true]";
+  }
+  return open + close;
+}
+
+template <int Depth>
+static void checkDepth() {
+  // The root takes one level, so Depth - 1 containers nest; one more overflows.
+  bool overflowed = true;
+  assert(nest<Depth>(Depth - 1, overflowed) == nested(Depth - 1) && !overflowed);
+  nest<Depth>(Depth, overflowed);
+  assert(overflowed);
+  nest<Depth>(Depth + 5, overflowed);
+  assert(overflowed);
+
+  // Objects count the same, and the levels around an overflowed one keep their commas.
+  char buffer[256];
+  BasicStaticJsonBuilder<Depth> builder(buffer, sizeof(buffer));
+  builder.beginObject();
+  for (int i = 0; i < Depth + 2; i++) {
+    builder.key("k");
+    builder.beginObject();
+  }
+  for (int i = 0; i < Depth + 2; i++) builder.endObject();
+  builder.key("after");
+  builder.value(1);
+  builder.endObject();
+  assert(builder.overflowed());
+  std::string out = builder.c_str();
+  assert(out.size() > 12 && out.compare(out.size() - 12, 12, "},\"after\":1}") == 0);
+}
+
+// A payload with every kind of value, including strings that need escaping and multibyte characters.
+static void build(StaticJsonBuilder& builder) {
+  builder.beginObject();
+  builder.key("text");
+  builder.value("Quote \" backslash \\ newline \n tab \t bell \x07 and €😀");
+  builder.key("numbers");
+  builder.beginArray();
+  builder.value(-12345);
+  builder.value(0.75f);
+  builder.value(3.14159f, 4);
+  builder.value(false);
+  builder.endArray();
+  builder.key("pieces");
+  builder.beginString();
+  builder.appendString("one ");
+  builder.appendString(String("two \"2\""));
+  builder.endString();
+  builder.key("empty");
+  builder.beginObject();
+  builder.endObject();
+  builder.endObject();
+}
+
+int main() {
+  checkDepth<2>();
+  checkDepth<4>();
+  checkDepth<JSON_MAX_DEPTH>();
+
+  // Every buffer size: the output is a terminated prefix of the full document that never passes the buffer,
+  // and overflowed() is set exactly when the document didn't fit.
+  char full[512];
+  StaticJsonBuilder reference(full, sizeof(full));
+  build(reference);
+  assert(!reference.overflowed());
+  const std::string want = full;
+  assert(want == "{\"text\":\"Quote \\\" backslash \\\\ newline \\n tab \\t bell \\u0007 and €😀\","
+                 "\"numbers\":[-12345,0.75,3.1416,false],\"pieces\":\"one two \\\"2\\\"\",\"empty\":{}}");
+  for (size_t capacity = 1; capacity <= want.size() + 1; capacity++) {
+    std::vector<char> buffer(capacity + 8, '#');
+    StaticJsonBuilder builder(buffer.data(), capacity);
+    build(builder);
+    std::string got = builder.c_str();
+    assert(got.size() < capacity && builder.size() == got.size());
+    assert(want.compare(0, got.size(), got) == 0);
+    assert(buffer[capacity] == '#');
+    assert(builder.overflowed() == (capacity <= want.size()));
+  }
+
+  // Through Gemini_AI: a request's payload nests five levels ({"contents":[{"parts":[{"text"...), so a policy
+  // with a depth of 5 refuses it instead of sending broken JSON, and 6 is enough.
+  BasicGemini<Depth5> shallow;
+  shallow.setApiKey("KEY");
+  shallow.begin(4096);
+  size_t sent = upstreamRequests();
+  shallow.getAnswer("Hi");
+  assert(upstreamRequests() == sent);
+  BasicGemini<Depth6> enough;
+  enough.setApiKey("KEY");
+  enough.begin(4096);
+  MockServer::push(httpResponse(answerJson("Hello.")));
+  assert(enough.getAnswer("Hi") == "Hello." && upstreamRequests() == sent + 1);
+  printf("OK\n");
+}
@@ -0,0 +1,73 @@
+// JsonStringEncoder throughput against a byte-at-a-time escaper, for prompt-like and escape-heavy text.
+#include "helpers.h"
+#include <JsonStringEncoder.hpp>
+#include <chrono>
+
+struct BufferSink {
+  char* out;
+  size_t length = 0;
+  void write(const char* data, size_t n) {
+    memcpy(out + length, data, n);
+    length += n;
+  }
+};
+
+// What escaping looked like before: one byte at a time, one write per byte.
+static size_t escapeBytewise(BufferSink& sink, const char* s, size_t length) {
+  static const char hex[] = "0123456789abcdef";
+  size_t start = sink.length;
+  for (size_t i = 0; i < length; i++) {
+    char c = s[i];
+    char escaped[6] = {'\\', 0};
+    size_t n = 2;
+    switch (c) {
+      case '"': escaped[1] = '"'; break;
+      case '\\': escaped[1] = '\\'; break;
+      case '\n': escaped[1] = 'n'; break;
+      case '\r': escaped[1] = 'r'; break;
+      case '\t': escaped[1] = 't'; break;
+      default:
+        if ((uint8_t)c < 0x20) {
+          memcpy(escaped + 1, "u00", 3);
+          escaped[4] = hex[(uint8_t)c >> 4];
+          escaped[5] = hex[c & 0x0F];
+          n = 6;
+        } else {
+          escaped[0] = c;
+          n = 1;
+        }
+    }
+    for (size_t k = 0; k < n; k++) sink.write(escaped + k, 1);
+  }
+  return sink.length - start;
+}
+
+template <typename F>
+static double megabytesPerSecond(const std::string& text, F escape) {
+  std::string out(text.size() * 6, '\0');
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  const int rounds = 4000;
+  for (int i = 0; i < rounds; i++) {
+    BufferSink sink{&out[0]};
+    total += escape(sink, text.data(), text.size());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  assert(total > 0);
+  return rounds * text.size() / seconds / 1e6;
+}
+
+int main() {
+  std::string prompt;
+  while (prompt.size() < 8192) prompt += "Summarize the following sensor log and point out anomalies.\nt=12.5C h=40%\n";
+  std::string heavy;
+  while (heavy.size() < 8192) heavy += "{\"k\":\"v\\n\"}\t";
+  printf("%-16s %12s %12s\n", "8 KB input", "bytewise", "encoder");
+  for (auto& c : {std::make_pair("prompt text", &prompt), std::make_pair("escape heavy", &heavy)}) {
+    double bytewise = megabytesPerSecond(*c.second, escapeBytewise);
+    double encoder = megabytesPerSecond(*c.second, [](BufferSink& sink, const char* s, size_t n) {
+      return JsonStringEncoder::encode(sink, s, n);
+    });
+    printf("%-16s %8.0f MB/s %7.0f MB/s  (x%.1f)\n", c.first, bytewise, encoder, encoder / bytewise);
+  }
+}
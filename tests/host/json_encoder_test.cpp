@@ -0,0 +1,86 @@
+// JsonStringEncoder round trips: every byte value, every alignment, through StreamJsonParser and the builder.
+#include "helpers.h"
+#include <JsonStringEncoder.hpp>
+#include <StaticJsonBuilder.hpp>
+#include <StreamJsonParser.hpp>
+
+struct StringSink {
+  std::string out;
+  void write(const char* data, size_t length) { out.append(data, length); }
+};
+
+static std::string encode(const std::string& s) {
+  StringSink sink;
+  size_t written = JsonStringEncoder::encode(sink, s.data(), s.size());
+  assert(written == sink.out.size() && written == JsonStringEncoder::measure(s.data(), s.size()));
+  return sink.out;
+}
+
+// Decodes with the library's own reader.
+static std::string decode(const std::string& escaped) {
+  StringStream json("{\"v\":\"" + escaped + "\"}");
+  StreamJsonParser parser(json);
+  assert(parser.find("v"));
+  std::string out;
+  parser.getValueStream([&out](char c) { out += c; });
+  return out;
+}
+
+static void checkValid(const std::string& escaped) {
+  for (size_t i = 0; i < escaped.size(); i++) {
+    uint8_t c = escaped[i];
+    assert(c >= 0x20);
+    if (c == '"') assert(i > 0 && escaped[i - 1] == '\\');
+  }
+}
+
+int main() {
+  // The escapes themselves.
+  assert(encode("plain text") == "plain text");
+  assert(encode("a\"b\\c") == "a\\\"b\\\\c");
+  assert(encode("line\nnext\r\ttab") == "line\\nnext\\r\\ttab");
+  assert(encode(std::string("\x01\x1f\b\f", 4)) == "\\u0001\\u001f\\b\\f");
+  assert(encode("h\xc3\xa9llo \xe2\x82\xac") == "h\xc3\xa9llo \xe2\x82\xac");
+
+  // Every byte, at every position inside a machine word.
+  for (int c = 1; c < 256; c++) {
+    for (size_t at = 0; at < 24; at++) {
+      std::string s(40, 'x');
+      s[at] = (char)c;
+      std::string escaped = encode(s);
+      checkValid(escaped);
+      assert(decode(escaped) == s);
+    }
+  }
+
+  // Random strings, unaligned starts and lengths.
+  unsigned seed = 3;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  };
+  std::string buffer(4096 + 16, '\0');
+  for (int round = 0; round < 2000; round++) {
+    size_t offset = next() % 8, length = next() % 600;
+    for (size_t i = 0; i < length; i++) {
+      unsigned r = next() % 10;
+      buffer[offset + i] = r < 6 ? 'a' + next() % 26 : r < 8 ? "\"\\\n\t\x01 /"[next() % 7] : (char)(1 + next() % 255);
+    }
+    std::string s(buffer.data() + offset, length);
+    StringSink sink;
+    JsonStringEncoder::encode(sink, buffer.data() + offset, length);
+    checkValid(sink.out);
+    assert(decode(sink.out) == s);
+  }
+
+  // The builder escapes once, in one pass: a newline in a question reaches the model as a newline.
+  char payload[256];
+  StaticJsonBuilder builder(payload, sizeof(payload));
+  builder.beginObject();
+  builder.key("text");
+  builder.value("two\nlines \"quoted\" \x02");
+  builder.endObject();
+  assert(!builder.overflowed());
+  assert(strcmp(payload, "{\"text\":\"two\\nlines \\\"quoted\\\" \\u0002\"}") == 0);
+  printf("OK\n");
+}
@@ -0,0 +1,31 @@
+// StreamJsonParser on arbitrary bytes. The first two bytes choose the depth limit, the key, the read call and
+// how the rest arrives. Every find()/read loop must terminate, nesting beyond the limit must not grow the stack,
+// and no call may produce more output than the input it consumed.
+#include <Arduino.h>
+#include <StreamJsonParser.hpp>
+#include <cassert>
+#include <string>
+#include "helpers.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 2) return 0;
+  uint8_t maxDepth = data[0];
+  uint8_t mode = data[1];
+  std::string doc((const char*)data + 2, size - 2);
+  static const char* keys[] = {"text", "values", "a", "totalTokens"};
+
+  // Every byte is readable at once, so a stall only happens at the end and the parser gives up right there.
+  TrickleStream source(doc, 1 + (mode & 0x1F) * 8, mode);
+  StreamJsonParser parser(source, maxDepth, 0, 1000);
+  size_t found = 0, produced = 0;
+  while (parser.find(keys[mode >> 6])) {
+    assert(++found <= doc.size());
+    if (mode & 0x20) {
+      parser.getFloatArray([&](float) { produced++; });
+    } else {
+      parser.getValueStream([&](char) { produced++; });
+    }
+    assert(produced <= doc.size());
+  }
+  return 0;
+}
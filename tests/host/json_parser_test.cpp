@@ -0,0 +1,80 @@
+// StreamJsonParser limits: nesting beyond the maximum depth is skipped without recursion, and every wait for data
+// ends at the idle or total deadline.
+#include "helpers.h"
+#include <StreamJsonParser.hpp>
+
+static std::string find(Stream& source, const char* key, StreamJsonParser* parser = nullptr) {
+  StreamJsonParser local(source, 8, 50, 500);
+  StreamJsonParser& p = parser ? *parser : local;
+  std::string out;
+  while (p.find(key)) {
+    p.getValueStream([&](char c) { out += c; });
+    out += '|';
+  }
+  return out;
+}
+
+static std::string find(const std::string& doc, const char* key) {
+  StringStream source(doc);
+  return find(source, key);
+}
+
+// One byte every `interval` ms, forever.
+class DripStream : public Stream {
+ public:
+  explicit DripStream(unsigned long interval) : _interval(interval), _next(millis()) {}
+  int available() override { return millis() >= _next ? 1 : 0; }
+  int read() override {
+    if (!available()) return -1;
+    _next = millis() + _interval;
+    return _count++ == 0 ? '[' : ' ';
+  }
+  int peek() override { return available() ? (_count == 0 ? '[' : ' ') : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  unsigned long _interval;
+  unsigned long _next;
+  unsigned _count = 0;
+};
+
+int main() {
+  assert(find(answerJson("Hi \\ud83d\\ude00 \\\"x\\\""), "text") == "Hi \xF0\x9F\x98\x80 \"x\"|");
+  assert(find("[{\"a\":{\"text\":1}},{\"text\":[2,{\"text\":\"x\"}]}]", "text") == "1|[2,{\"text\":\"x\"}]|");
+
+  // Within the limit of 8 levels the key is found; beyond it the container is skipped and the search goes on.
+  assert(find(std::string(7, '[') + "{\"text\":\"ok\"}" + std::string(7, ']'), "text") == "ok|");
+  assert(find("[" + std::string(8, '[') + "{\"text\":\"deep\"}" + std::string(8, ']') + ",{\"text\":\"ok\"}]", "text") ==
+         "ok|");
+
+  // A million open brackets cost no stack and time linear in their number.
+  for (size_t n : {(size_t)100000, (size_t)1000000}) {
+    std::string deep(n, '[');
+    deep += "{\"text\":\"deep\"}" + std::string(n, ']');
+    unsigned long start = millis();
+    assert(find(deep, "text") == "");
+    printf("%7zu levels: %lu ms\n", n, millis() - start);
+  }
+
+  // A response that stops in the middle of a string or a container gives up after the idle timeout.
+  for (const char* partial : {"{\"a\":{\"text\":\"abc", "{\"a\":[1,2", "{\"text\":\"\\u00", "{\"te"}) {
+    StringStream source(partial);
+    StreamJsonParser parser(source, 8, 50, 500);
+    unsigned long start = millis();
+    find(source, "text", &parser);
+    unsigned long took = millis() - start;
+    assert(parser.timedOut() && took >= 50 && took < 200);
+  }
+
+  // A stream that never stalls long enough for the idle timeout still ends at the total one.
+  {
+    DripStream source(10);
+    StreamJsonParser parser(source, 8, 50, 300);
+    unsigned long start = millis();
+    find(source, "text", &parser);
+    unsigned long took = millis() - start;
+    printf("drip: timed out after %lu ms\n", took);
+    assert(parser.timedOut() && took >= 300 && took < 450);
+  }
+  printf("OK\n");
+}
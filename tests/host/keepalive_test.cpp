@@ -0,0 +1,66 @@
+// GeminiClient on a kept-alive connection: a request is sent again on a new connection only when the old one
+// was found closed before the request could have been answered, never after a timeout or a partial response.
+#include "helpers.h"
+#include <GeminiClient.hpp>
+
+static int post(GeminiClient& client) {
+  int code = client.POST(String("{}"));
+  if (code > 0) {
+    Stream& body = client.getBodyStream();
+    while (!client.bodyEnded() && body.available() > 0) body.read();
+  }
+  client.end();
+  return code;
+}
+
+// A warm connection with one answered request on it.
+static void warmUp(GeminiClient& client) {
+  MockServer::push(httpResponse(answerJson("warm")));
+  assert(post(client) == 200);
+}
+
+int main() {
+  GeminiClient client;
+  client.begin("gemini-2.0-flash", "KEY");
+  client.setKeepAlive(true);
+  client.setTimeouts(1000, 200);
+
+  // A cold connection that fails is not retried.
+  MockServer::drop() = 1;
+  size_t requests = upstreamRequests();
+  assert(post(client) == HTTPC_ERROR_NOT_CONNECTED && upstreamRequests() - requests == 1);
+
+  // The server closed the idle connection: the request reaches nobody and is sent again.
+  warmUp(client);
+  MockServer::drop() = 1;
+  MockServer::push(httpResponse(answerJson("again")));
+  requests = upstreamRequests();
+  int connects = MockServer::connects();
+  assert(post(client) == 200);
+  assert(upstreamRequests() - requests == 2 && MockServer::connects() - connects == 1);
+
+  // No headers within the timeout: the server may still be working on it, so it isn't sent again.
+  warmUp(client);
+  MockServer::latency() = 400;
+  MockServer::push(httpResponse(answerJson("late")));
+  requests = upstreamRequests();
+  assert(post(client) == HTTPC_ERROR_READ_TIMEOUT && upstreamRequests() - requests == 1);
+  MockServer::latency() = 0;
+
+  // The response broke off after its first bytes.
+  warmUp(client);
+  MockServer::hangUp() = 1;
+  MockServer::push("HTTP/1.1 200 OK\r\nContent-Le");
+  requests = upstreamRequests();
+  assert(post(client) < 0 && upstreamRequests() - requests == 1);
+
+  // Something that isn't HTTP answered.
+  warmUp(client);
+  MockServer::push("garbage\r\n\r\n");
+  requests = upstreamRequests();
+  assert(post(client) == HTTPC_ERROR_NO_HTTP_SERVER && upstreamRequests() - requests == 1);
+
+  // The client still works afterwards.
+  warmUp(client);
+  printf("OK\n");
+}
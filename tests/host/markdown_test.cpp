@@ -0,0 +1,71 @@
+// MarkdownStripper (SpeechFilter.hpp): emphasis, links and block markers are removed, code and text that only
+// looks like markdown are left alone.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+static std::string strip(const std::string& in) {
+  std::string out;
+  MarkdownStripper stripper([&](char c) { out += c; });
+  for (char c : in) stripper.push(c);
+  stripper.finish();
+  return out;
+}
+
+static void check(const std::string& in, const std::string& want) {
+  std::string got = strip(in);
+  if (got != want) {
+    printf("FAIL [%s]\n  got  [%s]\n  want [%s]\n", in.c_str(), got.c_str(), want.c_str());
+    exit(1);
+  }
+}
+
+int main() {
+  // Arithmetic, indices, tables and identifiers.
+  check("2*3 = 6", "2*3 = 6");
+  check("2 * 3", "2 * 3");
+  check("2**10 is big", "2**10 is big");
+  check("arr[0] = 1", "arr[0] = 1");
+  check("x] y", "x] y");
+  check("a ~ b", "a ~ b");
+  check("a | b |\n|---|---|\n", "a | b |\n|---|---|\n");
+  check("my_var_name and __init__", "my_var_name and init");
+
+  // Code spans and fences pass through unchanged.
+  check("Run `print(2**10)` now", "Run `print(2**10)` now");
+  check("```python\nprint(2**10)\nx = [a](b)\n```\nDone **ok**", "```python\nprint(2**10)\nx = [a](b)\n```\nDone ok");
+  check("**`x*y`**", "`x*y`");
+
+  // Emphasis, nested or not, escapes, links and images.
+  check("This is **bold** and *it* and _em_ and ~~gone~~.", "This is bold and it and em and gone.");
+  check("**bold with *nested* words**", "bold with nested words");
+  check("a*b*c", "abc");
+  check("\\*literal\\*", "*literal*");
+  check("héllo **wörld**", "héllo wörld");
+  check("See [the docs](https://x.y/a_(b)) now", "See the docs now");
+  check("![img](u) and [ref][1]", "img and [ref][1]");
+
+  // Block markers at the start of a line.
+  check("* item\n- item\n# Head\n> quote\n---\n", "item\nitem\nHead\nquote\n\n");
+
+  // Unclosed emphasis, or more than the hold buffer can wait for, is written as it came.
+  check("**unclosed bold\nnext", "**unclosed bold\nnext");
+  std::string longText(MARKDOWN_HOLD_SIZE + 100, 'x');
+  check("*" + longText + "*", "*" + longText + "*");
+
+  // Through Gemini_AI: only with the filter enabled, and always for sentences.
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(4096);
+  std::string answer = answerJson("**Paris** is `x*y`. Second *one*.");
+  MockServer::push(httpResponse(answer));
+  assert(gemini.getAnswer("a") == "**Paris** is `x*y`. Second *one*.");
+  gemini.enableMarkdownFilter();
+  MockServer::push(chunkedResponse(answer, 3));
+  assert(gemini.getAnswer("b") == "Paris is `x*y`. Second one.");
+  gemini.disableMarkdownFilter();
+  MockServer::push(httpResponse(answer));
+  std::string sentences;
+  gemini.getAnswerSentences("c", [&](const char* sentence) { sentences += std::string(sentence) + "|"; });
+  assert(sentences == "Paris is `x*y`.|Second one.|");
+  printf("OK\n");
+}
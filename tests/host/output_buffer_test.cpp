@@ -0,0 +1,130 @@
+// OutputBuffer: slow sinks, a tee to two sinks, a sink without availableForWrite(), and every overflow policy.
+#include "helpers.h"
+#include <OutputBuffer.hpp>
+
+// Takes `rate` bytes per millisecond, as reported by availableForWrite(), like a UART's transmit buffer.
+class SlowSink : public Print {
+ public:
+  explicit SlowSink(size_t rate, size_t buffer = 64) : _rate(rate), _buffer(buffer), _last(millis()) {}
+
+  int availableForWrite() override {
+    _drain();
+    return _buffer - _queued;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override {
+    _drain();
+    size_t n = std::min(size, _buffer - _queued);
+    received.append((const char*)data, n);
+    _queued += n;
+    return n;
+  }
+
+  std::string received;
+
+ private:
+  size_t _rate, _buffer, _queued = 0;
+  unsigned long _last;
+
+  void _drain() {
+    unsigned long now = millis();
+    _queued -= std::min(_queued, (size_t)(now - _last) * _rate);
+    _last = now;
+  }
+};
+
+// A display-like Print that doesn't override availableForWrite() (so it reports 0).
+class PlainSink : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    received += (char)c;
+    return 1;
+  }
+  std::string received;
+};
+
+static std::string sampleText(size_t size) {
+  std::string text;
+  for (int i = 0; text.size() < size; i++) text += "Wort " + std::to_string(i) + " über ÄÖÜ 😀. ";
+  return text;
+}
+
+// Every sink got a prefix of `text` that ends on a character boundary.
+static bool intactPrefix(const std::string& got, const std::string& text) {
+  return text.compare(0, got.size(), got) == 0 && (got.size() == text.size() || (text[got.size()] & 0xC0) != 0x80);
+}
+
+int main() {
+  std::string text = sampleText(4000);
+
+  // Without availableForWrite() a sink still gets everything, a fallback chunk at a time.
+  {
+    PlainSink display;
+    OutputBuffer out;
+    out.begin(256);
+    out.addSink(display);
+    assert(out.write((const uint8_t*)text.data(), text.size()) == text.size());
+    out.flush();
+    assert(display.received == text && !out.failed());
+  }
+
+  // A tee: a fast and a slow sink both get the whole text; the slow one sets the pace.
+  {
+    SlowSink fast(1000), slow(4);
+    OutputBuffer out(OUTPUT_BLOCK);
+    out.begin(512);
+    out.addSink(fast);
+    out.addSink(slow);
+    unsigned long start = millis();
+    assert(out.write((const uint8_t*)text.data(), text.size()) == text.size());
+    out.flush();
+    unsigned long took = millis() - start;
+    assert(fast.received == text && slow.received == text && !out.failed());
+    assert(out.stats().stalls > 0 && out.stats().highWater <= 512 && out.stats().written == text.size());
+    printf("block: %zu bytes to a 4 KB/s sink in %lu ms, %u stalls\n", text.size(), took, out.stats().stalls);
+  }
+
+  // OUTPUT_BLOCK gives up after the stall timeout when a sink takes nothing at all.
+  {
+    SlowSink stuck(0);
+    OutputBuffer out(OUTPUT_BLOCK);
+    out.begin(128);
+    out.addSink(stuck);
+    out.setStallTimeout(50);
+    unsigned long start = millis();
+    out.write((const uint8_t*)text.data(), text.size());
+    assert(out.failed() && millis() - start < 500);
+    assert(intactPrefix(stuck.received, text));
+  }
+
+  // OUTPUT_DROP_NEWEST keeps going and drops whole characters; OUTPUT_FAIL keeps only the intact beginning.
+  {
+    SlowSink drop(0, 100), fail(0, 100);
+    OutputBuffer dropping(OUTPUT_DROP_NEWEST), failing(OUTPUT_FAIL);
+    dropping.begin(64);
+    failing.begin(64);
+    dropping.addSink(drop);
+    failing.addSink(fail);
+    assert(dropping.write((const uint8_t*)text.data(), text.size()) == text.size());
+    size_t accepted = failing.write((const uint8_t*)text.data(), text.size());
+    assert(accepted < text.size());
+    assert(!dropping.failed() && dropping.stats().dropped > 0 && dropping.stats().written <= 164);
+    // The sink may cut a character at its own buffer's edge, but what the buffer accepted ends on a boundary.
+    assert(failing.failed() && text.compare(0, fail.received.size(), fail.received) == 0);
+    assert(accepted == fail.received.size() + failing.buffered() && intactPrefix(text.substr(0, accepted), text));
+    for (size_t i = 0; i < drop.received.size(); i++) {
+      // Whatever was kept decodes: no continuation byte without its lead byte (the sink may cut the last one).
+      unsigned char c = drop.received[i];
+      if (c >= 0xC0) {
+        size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        for (size_t k = 1; k < length && i + k < drop.received.size(); k++) assert(((unsigned char)drop.received[i + k] & 0xC0) == 0x80);
+        i += length - 1;
+      } else {
+        assert((c & 0xC0) != 0x80);
+      }
+    }
+    dropping.reset();
+    assert(dropping.buffered() == 0);
+  }
+  printf("OK\n");
+}
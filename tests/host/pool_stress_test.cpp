@@ -0,0 +1,149 @@
+// Connection pool (ClientPool.hpp): aggregate throughput as the pool grows, every kind of request from several
+// tasks at once on a shared instance, and recovery from closed or failed connections.
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// `tasks` tasks asking `each` questions; returns answers per second.
+static double throughput(Gemini_AI& gemini, int tasks, int each) {
+  for (int i = 0; i < tasks * each; i++) {
+    std::string body = answerJson("answer " + std::to_string(i));
+    MockServer::push(i % 3 == 2 ? chunkedResponse(body) : httpResponse(body));
+  }
+  std::atomic<int> ok{0};
+  unsigned long start = millis();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < tasks; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < each; i++) {
+        if (gemini.getAnswer("hello there").startsWith("answer ")) ok++;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  unsigned long took = millis() - start;
+  assert(ok == tasks * each);
+  return ok * 1000.0 / std::max(took, 1UL);
+}
+
+// Answers generateContent, countTokens, embedContent and the cachedContents calls, checking that every answer
+// request names a complete cache.
+struct Server {
+  std::atomic<int> generates{0}, creates{0}, renewals{0}, badCache{0}, cacheNumber{0};
+
+  void operator()(std::string& out, std::string& in) {
+    size_t head = out.find("\r\n\r\n");
+    if (head == std::string::npos) return;
+    size_t field = out.find("Content-Length: ");
+    size_t length = field == std::string::npos || field > head ? 0 : atoi(out.c_str() + field + 16);
+    if (out.size() < head + 4 + length) return;
+    std::string request = out.substr(0, head + 4 + length);
+    out.erase(0, head + 4 + length);
+
+    std::string body = "{}";
+    if (request.rfind("PATCH", 0) == 0) {
+      renewals++;
+    } else if (request.find("cachedContents HTTP") != std::string::npos) {
+      creates++;
+      body = "{\"name\":\"cachedContents/c" + std::to_string(++cacheNumber) + "\"}";
+    } else if (request.find(":countTokens") != std::string::npos) {
+      body = "{\"totalTokens\":7}";
+    } else if (request.find("mbedContent") != std::string::npos) {
+      body = "{\"embedding\":{\"values\":[0.1,0.2,-0.3,0.4]}}";
+    } else if (request.rfind("DELETE", 0) != 0) {
+      generates++;
+      size_t name = request.find("\"cachedContent\":\"cachedContents/c");
+      if (name == std::string::npos || !isdigit((uint8_t)request[name + 33])) badCache++;
+      body = answerJson("ok");
+    }
+    in += httpResponse(body);
+  }
+};
+
+int main() {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  ESP.freeHeap = 400000;
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(8192);
+
+  // A TLS handshake and a server that each take tens of milliseconds.
+  MockServer::connectDelay() = 40;
+  MockServer::latency() = 20;
+  double single = throughput(gemini, 1, 12);
+  printf("no pool, 1 task:  %5.1f answers/s\n", single);
+  double rates[3];
+  int sizes[] = {1, 2, 4};
+  for (int i = 0; i < 3; i++) {
+    assert(gemini.enableConnectionPool(sizes[i]) == (size_t)sizes[i]);
+    rates[i] = throughput(gemini, 4, 6);
+    auto stats = gemini.getPoolStats();
+    printf("pool %d, 4 tasks: %5.1f answers/s (checkouts %u, reused %u, waits %u)\n", sizes[i], rates[i],
+           stats.checkouts, stats.reused, stats.waits);
+    assert(stats.timeouts == 0);
+  }
+  assert(rates[0] > single && rates[1] > rates[0] * 1.3 && rates[2] > rates[1] * 1.2);
+
+  // The server closes the connection after an answer, or answers with an error: the next request reconnects or
+  // reuses the connection as appropriate.
+  MockServer::connectDelay() = 0;
+  MockServer::latency() = 0;
+  gemini.enableConnectionPool(1);
+  MockServer::push(httpResponse(answerJson("zero")));
+  assert(gemini.getAnswer("w") == "zero");
+  MockServer::push("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: " + std::to_string(answerJson("one").size()) +
+                   "\r\n\r\n" + answerJson("one"));
+  MockServer::push(httpResponse(answerJson("two")));
+  int connects = MockServer::connects();
+  assert(gemini.getAnswer("x") == "one" && gemini.getAnswer("y") == "two");
+  assert(MockServer::connects() - connects == 1);
+  MockServer::push("HTTP/1.1 500 Internal\r\nContent-Length: 5\r\n\r\noops!");
+  MockServer::push(httpResponse(answerJson("three")));
+  gemini.getAnswer("x");
+  assert(gemini.getAnswer("y") == "three");
+  assert(gemini.evictIdleConnections(0) == 1);
+
+  // The pool is sized down to what the heap can hold, keeping one connection when even that is short.
+  ESP.freeHeap = 150000;
+  assert(gemini.enableConnectionPool(4) == 2);
+  ESP.freeHeap = 1000;
+  assert(gemini.enableConnectionPool(4) == 1);
+  gemini.disableConnectionPool();
+  assert(gemini.getPoolSize() == 0);
+  ESP.freeHeap = 400000;
+
+  // Answers, token counts, embeddings and cache renewals from four tasks on two connections.
+  Server server;
+  MockServer::latency() = 2;
+  MockServer::handler() = std::ref(server);
+  assert(gemini.enableConnectionPool(2) == 2);
+  assert(gemini.createCache("document", 1));
+  std::atomic<int> answers{0}, counts{0}, embeddings{0};
+  unsigned long end = millis() + 1500;
+  std::vector<std::thread> tasks;
+  for (int k = 0; k < 4; k++) {
+    tasks.emplace_back([&, k] {
+      while (millis() < end) {
+        if (k == 0) {
+          if (gemini.countTokens("hello") == 7) counts++;
+        } else if (k == 1) {
+          int8_t vector[4];
+          if (gemini.getEmbedding("hi", vector, 4)) embeddings++;
+        } else if (gemini.getAnswer("q") == "ok") {
+          answers++;
+        }
+      }
+    });
+  }
+  for (auto& task : tasks) task.join();
+  MockServer::handler() = nullptr;
+  printf("mixed: %d answers, %d token counts, %d embeddings, %d cache renewals\n", answers.load(), counts.load(),
+         embeddings.load(), server.renewals.load());
+  assert(answers > 0 && counts > 0 && embeddings > 0);
+  assert(answers == server.generates && server.badCache == 0);
+  assert(server.creates == 1 && server.renewals >= 1 && server.renewals <= 3);
+  assert(gemini.getCacheName() == "cachedContents/c1");
+  printf("OK\n");
+}
@@ -0,0 +1,94 @@
+// Replays captures through Gemini_AI: per response the time to the first answer character and to the end, with
+// the original timing, then the client and parser throughput when replayed as fast as possible.
+//
+//   build/replay_bench [CAPTURE...]      or: make replay CAPTURE="session.txt ..."
+//
+// A capture is what setCapture() recorded on the device (see TrafficCapture.hpp). Without one, a session is
+// first recorded from the mock server: a short answer, a long one with escapes, and a chunked one.
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <fstream>
+#include <sstream>
+
+static std::string recordSession(Gemini_AI& gemini) {
+  std::string text;
+  for (int i = 0; text.size() < 6000; i++) {
+    text += "Step " + std::to_string(i) + ": \\\"stir\\\" at 80\\u00b0C,\\n";
+  }
+  MockServer::latency() = 60;
+  MockServer::bandwidth() = 50;
+  MockServer::push(httpResponse(answerJson("Paris.")));
+  MockServer::push(httpResponse(answerJson(text)));
+  MockServer::push(chunkedResponse(answerJson(text), 1024));
+  StringStream file;
+  gemini.setCapture(&file);
+  for (int i = 0; i < 3; i++) gemini.getAnswer("question");
+  gemini.setCapture(nullptr);
+  MockServer::latency() = 0;
+  MockServer::bandwidth() = 0;
+  return file.data;
+}
+
+static size_t responses(const std::string& capture) {
+  size_t count = 0;
+  for (size_t at = 0; (at = capture.find("# response", at)) != std::string::npos; at++) count++;
+  return count;
+}
+
+int main(int argc, char** argv) {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(16384);
+
+  std::vector<std::pair<std::string, std::string>> captures;
+  for (int i = 1; i < argc; i++) {
+    std::ifstream file(argv[i], std::ios::binary);
+    if (!file) {
+      fprintf(stderr, "can't read %s\n", argv[i]);
+      return 1;
+    }
+    std::stringstream data;
+    data << file.rdbuf();
+    captures.emplace_back(argv[i], data.str());
+  }
+  if (captures.empty()) {
+    captures.emplace_back("mock session", recordSession(gemini));
+  }
+
+  for (const auto& capture : captures) {
+    size_t count = responses(capture.second);
+    printf("%s: %zu responses\n", capture.first.c_str(), count);
+    printf("  %-9s %8s %10s %8s %8s\n", "response", "bytes", "answer", "first", "last");
+    StringStream file(capture.second);
+    ReplayStream original(file, REPLAY_ORIGINAL);
+    gemini.setReplay(&original);
+    for (size_t i = 0; i < count; i++) {
+      uint32_t before = original.bytesReplayed();
+      size_t answer = 0;
+      unsigned long start = millis(), first = 0;
+      gemini.getAnswerStream("replay", [&](char) {
+        if (answer++ == 0) first = millis() - start;
+      });
+      printf("  %-9zu %8u %10zu %5lu ms %5lu ms\n", i + 1, original.bytesReplayed() - before, answer, first,
+             millis() - start);
+    }
+
+    // Whole capture as fast as possible, repeated for at least half a second.
+    uint32_t bytes = 0;
+    unsigned rounds = 0;
+    unsigned long start = millis();
+    do {
+      StringStream again(capture.second);
+      ReplayStream fast(again, REPLAY_FAST);
+      gemini.setReplay(&fast);
+      for (size_t i = 0; i < count; i++) gemini.getAnswerStream("replay", [](char) {});
+      bytes += fast.bytesReplayed();
+      rounds++;
+    } while (millis() - start < 500);
+    unsigned long took = millis() - start;
+    printf("  fast: %u rounds, %.1f MB/s of response\n", rounds, bytes / 1000.0 / std::max(took, 1UL));
+    gemini.setReplay(nullptr);
+  }
+  return 0;
+}
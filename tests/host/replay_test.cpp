@@ -0,0 +1,116 @@
+// CaptureStream/ReplayStream: a recorded session replays byte for byte through Gemini_AI, batch by batch, with the
+// original timing or as fast as possible.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+// One batch in the capture format: its time and size, then the bytes in lines of CAPTURE_LINE_BYTES.
+static std::string batch(unsigned long at, const std::string& data) {
+  std::string out = std::to_string(at) + "," + std::to_string(data.size()) + " ";
+  char b[3];
+  for (size_t i = 0; i < data.size(); i++) {
+    if (i > 0 && i % CAPTURE_LINE_BYTES == 0) out += "\n+ ";
+    snprintf(b, sizeof(b), "%02x", (unsigned char)data[i]);
+    out += b;
+  }
+  return out + "\n";
+}
+
+// The available() windows a reader sees, and what it reads.
+static std::vector<int> windows(ReplayStream& replay, std::string& out) {
+  std::vector<int> seen;
+  while (!replay.ended()) {
+    int n = replay.available();
+    if (!n) continue;
+    seen.push_back(n);
+    for (int i = 0; i < n; i++) {
+      int c = replay.read();
+      assert(c >= 0);
+      out += (char)c;
+    }
+  }
+  return seen;
+}
+
+int main() {
+  // Batches longer than a capture line are still replayed as one window.
+  {
+    std::string a(100, 'a'), b(40, 'b');
+    StringStream source(a), file;
+    CaptureStream capture(source, file);
+    capture.begin();
+    while (capture.available()) capture.read();
+    source.data += b;
+    while (capture.available()) capture.read();
+    capture.end();
+    for (ReplayTiming timing : {REPLAY_FAST, REPLAY_ORIGINAL}) {
+      StringStream recorded(file.data);
+      ReplayStream replay(recorded, timing);
+      assert(replay.nextResponse());
+      std::string out;
+      assert(windows(replay, out) == std::vector<int>({100, 40}) && out == a + b);
+      assert(!replay.nextResponse());
+    }
+  }
+
+  // Captures without batch sizes replay a line at a time.
+  {
+    StringStream recorded("# response\n0 616263\n+ 6465\n");
+    ReplayStream replay(recorded, REPLAY_FAST);
+    assert(replay.nextResponse());
+    std::string out;
+    windows(replay, out);
+    assert(out == "abcde");
+  }
+
+  // A live session over a slow link, replayed: the same answers, in about the same time or much faster.
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(4096);
+  MockServer::latency() = 80;
+  MockServer::bandwidth() = 2;
+  StringStream file;
+  gemini.setCapture(&file);
+  MockServer::push(httpResponse(answerJson("Paris \\u00e9 \\\"q\\\" and a long tail, to pass a capture line")));
+  MockServer::push(chunkedResponse(answerJson("Second"), 16));
+  unsigned long start = millis();
+  String first = gemini.getAnswer("q1"), second = gemini.getAnswer("q2");
+  unsigned long live = millis() - start;
+  gemini.setCapture(nullptr);
+  MockServer::latency() = 0;
+  MockServer::bandwidth() = 0;
+  assert(first == "Paris \xC3\xA9 \"q\" and a long tail, to pass a capture line" && second == "Second");
+  size_t requests = upstreamRequests();
+
+  for (ReplayTiming timing : {REPLAY_ORIGINAL, REPLAY_FAST}) {
+    StringStream recorded(file.data);
+    ReplayStream replay(recorded, timing);
+    gemini.setReplay(&replay);
+    start = millis();
+    assert(gemini.getAnswer("q1") == first && gemini.getAnswer("q2") == second);
+    unsigned long took = millis() - start;
+    printf("%s: %lu ms (live %lu ms), %u bytes\n", timing == REPLAY_FAST ? "fast    " : "original", took, live,
+           replay.bytesReplayed());
+    assert(timing == REPLAY_FAST ? took < live / 4 : took + 40 > live && took < live + 100);
+    assert(replay.bytesReplayed() > 0);
+    gemini.setReplay(nullptr);
+  }
+  assert(upstreamRequests() == requests);
+
+  // A hand written capture: an escape split across batches, each batch released at its time.
+  {
+    std::string body = answerJson("a\\u00e9b");
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    size_t split = body.find("\\u00") + 3;
+    std::string capture = "# recorded by hand\n# response\n" + batch(100, head) + batch(200, body.substr(0, split)) +
+                          batch(300, body.substr(split));
+    StringStream recorded(capture);
+    ReplayStream replay(recorded);
+    gemini.setReplay(&replay);
+    start = millis();
+    assert(gemini.getAnswer("x") == "a\xC3\xA9" "b");
+    unsigned long took = millis() - start;
+    assert(took >= 300 && took < 400);
+    gemini.setReplay(nullptr);
+  }
+  printf("OK\n");
+}
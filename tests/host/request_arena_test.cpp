@@ -0,0 +1,81 @@
+// RequestArena: alignment, exhaustion, growing the tail, reset and reuse; and answers through Gemini_AI when the
+// gzip decoder leaves no room in the arena (it used to write the answer's terminator past its end).
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <zlib.h>
+
+static std::string gzip(const std::string& data) {
+  z_stream z{};
+  deflateInit2(&z, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&z, data.size()), '\0');
+  z.next_in = (Bytef*)data.data();
+  z.avail_in = data.size();
+  z.next_out = (Bytef*)&out[0];
+  z.avail_out = out.size();
+  deflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+int main() {
+  // Every allocation is aligned as asked, relative to a block that malloc() aligned.
+  RequestArena arena;
+  assert(arena.allocate(1) == nullptr && arena.capacity() == 0);
+  assert(arena.begin(256) && arena.capacity() == 256 && arena.used() == 0);
+  uint8_t* base = (uint8_t*)arena.allocate(3, 1);
+  assert(base && arena.used() == 3 && arena.owns(base));
+  uint8_t* word = (uint8_t*)arena.allocate(4);
+  assert(word == base + 4 && (uintptr_t)word % 4 == 0);
+  uint8_t* odd = (uint8_t*)arena.allocate(1, 1);
+  assert(odd == base + 8);
+  uint8_t* wide = (uint8_t*)arena.allocate(16, 16);
+  assert(wide == base + 16 && (uintptr_t)wide % 16 == 0 && arena.used() == 32);
+  memset(base, 0xAB, arena.used());
+
+  // Exhaustion: a request that doesn't fit gets nullptr and changes nothing, neither does one that only fits
+  // before its alignment padding.
+  assert(arena.allocate(225) == nullptr && arena.used() == 32);
+  assert(arena.allocate(224, 1) == base + 32 && arena.remaining() == 0);
+  assert(arena.allocate(1, 1) == nullptr && arena.allocate(0, 1) == base + 256);
+  arena.reset();
+  assert(arena.allocate(250, 1) && arena.allocate(4, 8) == nullptr && arena.used() == 250);
+  assert(!arena.owns(base + 256) && !arena.owns(base - 1));
+
+  // The tail grows in place until the arena is full, and not a byte further.
+  arena.reset();
+  char* tail = arena.tail();
+  assert(tail == (char*)base && arena.commit(200) && arena.tail() == tail + 200);
+  assert(!arena.commit(57) && arena.used() == 200 && arena.commit(56) && arena.remaining() == 0);
+  assert(!arena.commit(1) && arena.tail() == (char*)base + 256);
+
+  // reset() and Scope free everything at once, the high-water mark stays; begin() with the same size keeps the
+  // block, another size replaces it.
+  arena.reset();
+  assert(arena.used() == 0 && arena.highWater() == 256);
+  {
+    RequestArena::Scope scope(arena);
+    assert(arena.allocate(100) == base);
+  }
+  assert(arena.used() == 0);
+  arena.allocate(10);
+  assert(arena.begin(256) && arena.used() == 0 && arena.allocate(1, 1) == base);
+  assert(arena.begin(64) && arena.capacity() == 64 && arena.highWater() == 0 && arena.allocate(65) == nullptr);
+  arena.end();
+  assert(arena.capacity() == 0 && arena.allocate(1) == nullptr);
+
+  // Through Gemini_AI: with gzip, the decoders take most of the arena before the answer takes its tail. For every
+  // size from a window to a window and 511 bytes, some leave nothing at all; the answer then goes to the heap.
+  std::string answer = "The reset button is on the back, next to the USB port. Hold it for five seconds.";
+  std::string response = httpResponse(gzip(answerJson(answer)), "Content-Encoding: gzip\r\n");
+  for (size_t size = GZIP_WINDOW_SIZE; size < GZIP_WINDOW_SIZE + 512; size++) {
+    Gemini_AI gemini;
+    gemini.setApiKey("KEY");
+    assert(gemini.begin(size));
+    gemini.enableCompression();
+    MockServer::push(response);
+    String got = gemini.getAnswer("Where is the reset button?");
+    assert(std::string(got.c_str()) == answer && gemini.getArenaHighWater() <= size);
+  }
+  printf("OK\n");
+}
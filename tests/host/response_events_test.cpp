@@ -0,0 +1,108 @@
+// ResponseEventReader: every kind of part, sources and usage in one pass, unknown members skipped, and the same
+// events however the response is split into batches.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+// What a read delivered, in order: "T:" text, "C:" code, "O:" code output, "S:" source, "U:" usage.
+struct Log {
+  std::string events;
+  std::string part;
+  size_t delivered = 0;
+
+  ResponseEvents all() {
+    ResponseEvents e;
+    e.onText = [this](char c) { part += c; };
+    e.onCode = [this](char c) { part += c; };
+    e.onCodeOutput = [this](char c) { part += c; };
+    e.onPartEnd = [this](ResponsePart kind) {
+      events += std::string(kind == PART_TEXT ? "T:" : kind == PART_CODE ? "C:" : "O:") + part + "|";
+      part.clear();
+    };
+    e.onSource = [this](const char* uri, const char* title) { events += std::string("S:") + uri + " " + title + "|"; };
+    e.onUsage = [this](uint32_t prompt, uint32_t answer) { events += "U:" + std::to_string(prompt) + "+" + std::to_string(answer) + "|"; };
+    return e;
+  }
+};
+
+static Log readAll(const std::string& body, size_t batch, ResponseEvents (*choose)(Log&) = nullptr) {
+  Log log;
+  TrickleStream stream(body, batch, (unsigned)batch);
+  ResponseEventReader reader(stream, JSON_PARSER_MAX_DEPTH, 200, 2000);
+  ResponseEvents events = choose ? choose(log) : log.all();
+  log.delivered = reader.read(events);
+  return log;
+}
+
+int main() {
+  // Text, code, its output, more text, two sources (one with escapes in the title), a chunk that isn't "web", and
+  // usage; among them members the reader doesn't know, some of them nested and with brackets in strings.
+  std::string body =
+      "{\"candidates\":[{\"content\":{\"parts\":["
+      "{\"text\":\"Let me compute \\\"2^10\\\".\\n\"},"
+      "{\"executableCode\":{\"language\":\"PYTHON\",\"code\":\"print(2**10)\\n\",\"id\":{\"x\":[1,{\"y\":\"}]\"}]}}},"
+      "{\"codeExecutionResult\":{\"outcome\":\"OUTCOME_OK\",\"output\":\"1024\\n\"}},"
+      "{\"thought\":true,\"text\":\"It is 1024 \\u00e9\\ud83d\\ude00.\"}],"
+      "\"role\":\"model\"},"
+      "\"finishReason\":\"STOP\",\"safetyRatings\":[{\"category\":\"X\",\"probability\":\"NEGLIGIBLE\"}],"
+      "\"groundingMetadata\":{\"searchEntryPoint\":{\"renderedContent\":\"<a href=\\\"x\\\">{[chip]}</a>\"},"
+      "\"groundingChunks\":[{\"web\":{\"uri\":\"https://a.example/1\",\"title\":\"A \\\"one\\\"\"}},"
+      "{\"retrievedContext\":{\"uri\":\"ignored\"}},"
+      "{\"web\":{\"title\":\"b.example\",\"domain\":\"b\",\"uri\":\"https://b.example/2\"}}],"
+      "\"groundingSupports\":[{\"segment\":{\"startIndex\":0,\"endIndex\":5},\"groundingChunkIndices\":[0]}],"
+      "\"webSearchQueries\":[\"2^10\"]}}],"
+      "\"usageMetadata\":{\"promptTokenCount\":27,\"candidatesTokenCount\":1234,\"totalTokenCount\":1261,"
+      "\"promptTokensDetails\":[{\"modality\":\"TEXT\",\"tokenCount\":27}]},"
+      "\"modelVersion\":\"gemini-2.5-flash\",\"responseId\":\"abc\"}";
+  const std::string want =
+      "T:Let me compute \"2^10\".\n|C:print(2**10)\n|O:1024\n|T:It is 1024 é😀.|"
+      "S:https://a.example/1 A \"one\"|S:https://b.example/2 b.example|U:27+1234|";
+
+  // Split at every batch size from one byte to the whole response.
+  for (size_t batch : {(size_t)1, (size_t)2, (size_t)3, (size_t)5, (size_t)17, (size_t)64, body.size()}) {
+    Log log = readAll(body, batch);
+    if (log.events != want) {
+      printf("batch %zu\n  got  %s\n  want %s\n", batch, log.events.c_str(), want.c_str());
+      return 1;
+    }
+    assert(log.delivered == 6);
+  }
+
+  // Parts without a callback are skipped whole, and don't count.
+  Log textOnly = readAll(body, 3, [](Log& log) {
+    ResponseEvents e = log.all();
+    e.onCode = nullptr;
+    e.onCodeOutput = nullptr;
+    e.onSource = nullptr;
+    e.onUsage = nullptr;
+    return e;
+  });
+  assert(textOnly.events == "T:Let me compute \"2^10\".\n|T:It is 1024 é😀.|" && textOnly.delivered == 2);
+
+  // Members the reader doesn't know, before and between the ones it does, including keys longer than it keeps.
+  std::string unknown =
+      "{\"promptFeedback\":{\"blockReason\":null},\"aVeryLongKeyThatDoesNotFitTheKeyBuffer\":[[[\"text\"]]],"
+      "\"candidates\":[{\"index\":0,\"content\":{\"parts\":[{\"inlineData\":{\"mimeType\":\"image/png\",\"data\":\"iVBOR\"}},"
+      "{\"textLikeButLonger\":\"no\",\"text\":\"yes\"}]},\"citationMetadata\":{\"citations\":[]}}],"
+      "\"usageMetadata\":{\"trafficType\":\"ON_DEMAND\",\"candidatesTokenCount\":2}}";
+  for (size_t batch : {(size_t)1, (size_t)7, unknown.size()}) {
+    Log log = readAll(unknown, batch);
+    assert(log.events == "T:yes|U:0+2|" && log.delivered == 1);
+  }
+
+  // A truncated response delivers what arrived and returns after the idle timeout instead of hanging.
+  std::string cut = body.substr(0, body.find("1024 "));
+  unsigned long start = millis();
+  Log partial = readAll(cut, 5);
+  assert(millis() - start < 1000);
+  assert(partial.events == "T:Let me compute \"2^10\".\n|C:print(2**10)\n|O:1024\n|T:It is |" && partial.delivered == 4);
+
+  // Through Gemini_AI, with the response chunked.
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(4096);
+  MockServer::push(chunkedResponse(body, 7));
+  Log live;
+  assert(gemini.getAnswerEvents("What is 2^10?", live.all()) == 6);
+  assert(live.events == want);
+  printf("OK\n");
+}
@@ -0,0 +1,6 @@
+// Globals of the core, defined once for every host test.
+#include <Arduino.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
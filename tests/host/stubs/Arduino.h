@@ -0,0 +1,272 @@
+/*
+ * Arduino.h - Minimal host stand-in for the Arduino core, WiFi and the secure client, for the host tests.
+ *
+ * Only what the library uses is here, built on the standard library. The secure client talks to MockServer,
+ * which answers every complete request (headers plus Content-Length body) with the next queued response, or
+ * hands the raw request to handler() when one is set. connectDelay(), latency(), bandwidth(), drop()
+ * (close instead of answering) and hangUp() (close after the answer) simulate a slow or unreliable network.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+typedef bool boolean;
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+#define PSTR(x) (x)
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_float(p) (*(const float*)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+class String {
+ public:
+  std::string s;
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const char* c, unsigned int length) : s(c, length) {}
+  String(const __FlashStringHelper* c) : s((const char*)c) {}
+  String(const std::string& c) : s(c) {}
+  String(char c) : s(1, c) {}
+  explicit String(int v) : s(std::to_string(v)) {}
+  explicit String(unsigned v) : s(std::to_string(v)) {}
+  explicit String(long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long v) : s(std::to_string(v)) {}
+  explicit String(long long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long long v) : s(std::to_string(v)) {}
+  explicit String(float v, unsigned char d = 2) { char b[32]; snprintf(b, 32, "%.*f", d, v); s = b; }
+  explicit String(double v, unsigned char d = 2) { char b[32]; snprintf(b, 32, "%.*f", d, v); s = b; }
+  bool reserve(unsigned n) { s.reserve(n); return true; }
+  unsigned length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  char* begin() { return &s[0]; }
+  char* end() { return &s[0] + s.size(); }
+  const char* begin() const { return s.data(); }
+  const char* end() const { return s.data() + s.size(); }
+  bool concat(const String& o) { s += o.s; return true; }
+  bool concat(const char* o) { s += o; return true; }
+  bool concat(const char* o, unsigned n) { s.append(o, n); return true; }
+  bool concat(const __FlashStringHelper* o) { s += (const char*)o; return true; }
+  bool concat(char c) { s += c; return true; }
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(int v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+  String& operator+=(long v) { s += std::to_string(v); return *this; }
+  String& operator+=(const __FlashStringHelper* o) { s += (const char*)o; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+  friend String operator+(const String& a, char b) { return String(a.s + b); }
+  friend String operator+(const String& a, int b) { return String(a.s + std::to_string(b)); }
+  friend String operator+(const String& a, unsigned long b) { return String(a.s + std::to_string(b)); }
+  friend String operator+(const String& a, const __FlashStringHelper* b) { return String(a.s + (const char*)b); }
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+  char operator[](unsigned i) const { return s[i]; }
+  char charAt(unsigned i) const { return s[i]; }
+  int indexOf(char c, unsigned from = 0) const { auto p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const char* c, unsigned from = 0) const { auto p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& c, unsigned from = 0) const { return indexOf(c.c_str(), from); }
+  String substring(unsigned a) const { return a >= s.size() ? String() : String(s.substr(a)); }
+  String substring(unsigned a, unsigned b) const { return a >= s.size() ? String() : String(s.substr(a, b - a)); }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void trim() { size_t a = s.find_first_not_of(" \t\r\n"); if (a == std::string::npos) { s.clear(); return; } size_t b = s.find_last_not_of(" \t\r\n"); s = s.substr(a, b - a + 1); }
+  void toLowerCase() { for (auto& c : s) c = tolower(c); }
+  bool startsWith(const char* p) const { return s.rfind(p, 0) == 0; }
+  bool startsWith(const String& p) const { return s.rfind(p.s, 0) == 0; }
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(s.c_str(), o.c_str()) == 0; }
+  bool isEmpty() const { return s.empty(); }
+  void remove(unsigned i) { s.erase(i); }
+  void remove(unsigned i, unsigned n) { s.erase(i, n); }
+  void clear() { s.clear(); }
+  operator bool() const { return true; }
+};
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* b, size_t n) { size_t i = 0; for (; i < n; i++) if (!write(b[i])) break; return i; }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t write(const char* s, size_t n) { return write((const uint8_t*)s, n); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(float v, int d = 2) { return print(String(v, d)); }
+  size_t print(double v, int d = 2) { return print(String(v, d)); }
+  template <class T> size_t println(const T& v) { size_t n = print(v); return n + print("\r\n"); }
+  size_t println() { return print("\r\n"); }
+};
+class Stream : public Print {
+ public:
+  unsigned long _timeout = 1000;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long t) { _timeout = t; }
+  // Like the core's: waits up to the timeout for every byte.
+  int timedRead();
+  size_t readBytes(char* b, size_t n) { size_t i = 0; while (i < n) { int c = timedRead(); if (c < 0) break; b[i++] = c; } return i; }
+  size_t readBytes(uint8_t* b, size_t n) { return readBytes((char*)b, n); }
+  String readStringUntil(char t) { String r; int c; while ((c = timedRead()) >= 0 && c != t) r += (char)c; return r; }
+};
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { putchar(c); return 1; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int availableForWrite() override { return 128; }
+};
+extern HardwareSerial Serial;
+inline unsigned long millis() { using namespace std::chrono; return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count(); }
+inline unsigned long micros() { using namespace std::chrono; return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count(); }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  } while (millis() - start < _timeout);
+  return -1;
+}
+inline void yield() {}
+inline void delayMicroseconds(unsigned us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline long random(long a, long b) { return a + rand() % (b - a); }
+inline long random(long b) { return rand() % b; }
+struct EspClass { uint32_t freeHeap = 100000; uint32_t maxBlock = 60000; uint32_t getFreeHeap() { return freeHeap; } uint32_t getMaxFreeBlockSize() { return maxBlock; } uint32_t getMaxAllocHeap() { return maxBlock; } uint32_t random() { return rand(); } };
+extern EspClass ESP;
+inline uint32_t esp_random() { return ((uint32_t)rand() << 16) ^ rand(); }
+class IPAddress {
+ public:
+  uint8_t b[4] = {0,0,0,0};
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t c, uint8_t d, uint8_t e) { b[0]=a;b[1]=c;b[2]=d;b[3]=e; }
+  IPAddress(uint32_t v) { memcpy(b, &v, 4); }
+  operator uint32_t() const { uint32_t v; memcpy(&v, b, 4); return v; }
+  bool isSet() const { return (uint32_t)*this != 0; }
+  String toString() const { return String("0.0.0.0"); }
+};
+#define WL_CONNECTED 3
+struct WiFiClass { int queries = 0; int status() { return WL_CONNECTED; } int hostByName(const char*, IPAddress& ip) { queries++; delay(dnsDelay); ip = IPAddress(1,2,3,4); return 1; } int dnsDelay = 0; };
+extern WiFiClass WiFi;
+class WiFiClient : public Stream {
+ public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t n) override { return n; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t*, size_t) { return 0; }
+  int peek() override { return -1; }
+  uint8_t connected() { return 0; }
+  int connect(const char*, uint16_t) { return 1; }
+  int connect(const char*, uint16_t, int32_t) { return 1; }
+  int connect(IPAddress, uint16_t) { return 1; }
+  int connect(IPAddress, uint16_t, int32_t) { return 1; }
+  void stop() {}
+  void setNoDelay(bool) {}
+  operator bool() { return connected(); }
+};
+#include <deque>
+#include <mutex>
+// A scriptable server. push() queues responses; handler(out, in) may instead consume requests from `out` and
+// append the answer to `in` itself.
+struct MockServer {
+  static std::mutex& m() { static std::mutex x; return x; }
+  static std::deque<std::string>& responses() { static std::deque<std::string> r; return r; }
+  static std::vector<std::string>& requests() { static std::vector<std::string> r; return r; }
+  static int& connects() { static int c = 0; return c; }
+  static int& connectDelay() { static int d = 0; return d; }
+  static int& latency() { static int d = 0; return d; }
+  static int& drop() { static int d = 0; return d; }
+  static int& hangUp() { static int d = 0; return d; }
+  static int& bandwidth() { static int d = 0; return d; }
+  static std::function<void(std::string& out, std::string& in)>& handler() { static std::function<void(std::string&, std::string&)> h; return h; }
+  static void push(const std::string& r) { std::lock_guard<std::mutex> g(m()); responses().push_back(r); }
+};
+class SecureStub : public WiFiClient {
+ public:
+  std::string in, out; size_t pos = 0; bool conn = false; bool served = false;
+  bool probeMaxFragmentLength(const char*, uint16_t, uint16_t) { return true; }
+  bool setCACert_P(const char*) { return true; }
+  bool setCACert_P(const char*, size_t) { return true; }
+  bool setFingerprint(const char*) { return true; }
+  bool setCACert(const char*) { return true; }
+  void setInsecure() {}
+  void setBufferSizes(int, int) {}
+  void setHandshakeTimeout(unsigned long) {}
+  int connect(const char*, uint16_t) { if (MockServer::connectDelay()) delay(MockServer::connectDelay()); std::lock_guard<std::mutex> g(MockServer::m()); MockServer::connects()++; conn = true; keep = true; in.clear(); pos = 0; out.clear(); return 1; }
+  int connect(const char* h, uint16_t p, int32_t) { IPAddress ip; WiFi.hostByName(h, ip); return connect(h, p); }
+  int connect(IPAddress, uint16_t p) { return connect("", p); }
+  int connect(IPAddress, uint16_t p, int32_t) { return connect("", p); }
+  int connect(IPAddress, uint16_t p, const char*, const char*, const char*, const char*) { return connect("", p); }
+  size_t write(uint8_t c) override { out += (char)c; check(); return 1; }
+  size_t write(const uint8_t* b, size_t n) override { out.append((const char*)b, n); check(); return n; }
+  using Print::write;
+  void check() {
+    if (MockServer::handler()) { MockServer::handler()(out, in); return; }
+    size_t h = out.find("\r\n\r\n"); if (h == std::string::npos) return;
+    size_t cl = out.find("Content-Length: "); size_t len = cl == std::string::npos ? 0 : atoi(out.c_str() + cl + 16);
+    if (out.size() >= h + 4 + len) {
+      std::lock_guard<std::mutex> g(MockServer::m());
+      MockServer::requests().push_back(out.substr(0, h + 4 + len)); out.erase(0, h + 4 + len);
+      if (MockServer::drop() > 0) { MockServer::drop()--; keep = false; return; }
+      // Bandwidth is counted from the start of this response, so drop what was already read.
+      in.erase(0, pos); pos = 0;
+      if (!MockServer::responses().empty()) { in += MockServer::responses().front(); MockServer::responses().pop_front(); }
+      if (MockServer::hangUp() > 0) { MockServer::hangUp()--; keep = false; }
+      readyAt = millis() + MockServer::latency();
+    }
+  }
+  unsigned long readyAt = 0;
+  bool ready() { return millis() >= readyAt; }
+  size_t arrived() { if (!MockServer::bandwidth()) return in.size(); return std::min(in.size(), (size_t)(millis() - readyAt + 1) * MockServer::bandwidth()); }
+  int available() override { return ready() && arrived() > pos ? arrived() - pos : 0; }
+  int read() override { return available() > 0 ? (uint8_t)in[pos++] : -1; }
+  int read(uint8_t* b, size_t n) { size_t k = std::min(n, (size_t)std::max(available(), 0)); memcpy(b, in.data() + pos, k); pos += k; return k; }
+  int peek() override { return available() > 0 ? (uint8_t)in[pos] : -1; }
+  uint8_t connected() { return conn && (pos < in.size() || keep); }
+  bool keep = true;
+  void stop() { conn = false; keep = true; in.clear(); pos = 0; out.clear(); }
+};
+using WiFiClientSecure = SecureStub;
+using NetworkClientSecure = SecureStub;
+using NetworkClient = WiFiClient;
+class StringStream : public Stream {
+ public:
+  std::string data; size_t pos = 0;
+  StringStream(const std::string& d = "") : data(d) {}
+  size_t write(uint8_t c) override { data += (char)c; return 1; }
+  using Print::write;
+  int available() override { return data.size() - pos; }
+  int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+  int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+};
@@ -0,0 +1,126 @@
+// TokenEstimator calibration, the maxOutputTokens chosen per request from free memory, the policy ceiling, and
+// prompts or payloads too large to send.
+#include "helpers.h"
+#include <Gemini_AI.h>
+
+// maxOutputTokens of the last request, -1 if it had none.
+static long sentLimit() {
+  std::lock_guard<std::mutex> lock(MockServer::m());
+  const std::string& request = MockServer::requests().back();
+  size_t at = request.find("\"maxOutputTokens\":");
+  return at == std::string::npos ? -1 : atol(request.c_str() + at + 18);
+}
+
+struct CappedPolicy : DefaultGeminiPolicy {
+  static constexpr int maxTokens = 50;
+};
+
+int main() {
+  // Byte classes, in 1/256 tokens.
+  assert(TokenEstimator::weigh("word") == 4 * 58 && TokenEstimator::weigh("2026") == 4 * 256);
+  assert(TokenEstimator::weigh("é") == 96 && TokenEstimator::weigh("€") == 230 && TokenEstimator::weigh("😀") == 512);
+  assert(TokenEstimator::weigh(nullptr) == 0);
+
+  // Each real count moves the scale a quarter of the way; tiny samples are ignored and the scale stays in 0.25..4.
+  TokenEstimator estimator;
+  assert(estimator.tokens(256 * 40) == 40 && estimator.scale() == 1.0f);
+  estimator.calibrate(256 * 40, 80);
+  assert(estimator.scale() == 1.25f && estimator.tokens(256 * 40) == 50);
+  for (int i = 0; i < 40; i++) estimator.calibrate(256 * 40, 80);
+  assert(estimator.scale() > 1.99f && estimator.scale() <= 2.0f);
+  estimator.calibrate(256 * 4, 400);
+  assert(estimator.scale() > 1.99f);
+  for (int i = 0; i < 40; i++) estimator.calibrate(256 * 10, 1000);
+  assert(estimator.scale() > 3.99f && estimator.scale() <= 4.0f);
+  for (int i = 0; i < 40; i++) estimator.calibrate(256 * 1000, 10);
+  assert(estimator.scale() >= 0.25f && estimator.scale() < 0.26f);
+
+  // Answer bytes per token start at 4 and follow candidatesTokenCount the same way.
+  assert(estimator.bytesPerToken() == 4.0f && estimator.tokensFor(4000) == 1000 && estimator.bytesFor(1000) == 4000);
+  estimator.calibrateOutput(800, 100);
+  assert(estimator.bytesPerToken() == 5.0f && estimator.tokensFor(4000) == 800);
+  estimator.calibrateOutput(4, 1);
+  assert(estimator.bytesPerToken() == 5.0f);
+  estimator.restore(100.0f, 0.0f);
+  assert(estimator.scale() == 4.0f && estimator.bytesPerToken() == 1.0f);
+
+  // Plain responses calibrate through usageMetadata, countTokens() through its count; batches don't.
+  Gemini_AI gemini;
+  gemini.setApiKey("KEY");
+  gemini.begin(4096);
+  gemini.disableCompression();
+  TokenEstimator& live = gemini.getTokenEstimator();
+  MockServer::push(httpResponse(answerJson("Paris is the capital of France and its largest city.")));
+  gemini.getAnswer("What is the capital of France?");
+  assert(live.scale() != 1.0f && gemini.getLastUsage().promptTokens == 12 && gemini.getLastUsage().answerTokens == 3);
+  float scale = live.scale();
+  MockServer::push(httpResponse(answerJson("[\\\"a\\\",\\\"b\\\"]")));
+  String questions[] = {"One?", "Two?"}, answers[2];
+  assert(gemini.getAnswers(questions, answers, 2) == 2 && live.scale() == scale);
+  MockServer::push(httpResponse("{\"totalTokens\": 400}"));
+  String text(std::string(1000, 'a').c_str());
+  assert(gemini.countTokens(text) == 400 && live.scale() > scale);
+  live.restore(1.0f, 4.0f);
+
+  // getAnswer(): as many tokens as fit in the arena (after the header buffer) plus the heap above the reserve.
+  auto affordable = [&](size_t heap) {
+    return (long)live.tokensFor(4096 - HEADER_BUFFER_SIZE - 64 + (heap > GEMINI_HEAP_RESERVE ? heap - GEMINI_HEAP_RESERVE : 0));
+  };
+  for (uint32_t heap : {60000u, 200000u, 1000u}) {
+    ESP.maxBlock = heap;
+    live.restore(1.0f, 4.0f);
+    long want = affordable(heap);
+    MockServer::push(httpResponse(answerJson("ok")));
+    gemini.getAnswer("Hi");
+    assert(sentLimit() == want && gemini.getLastUsage().maxOutputTokens == want);
+  }
+  ESP.maxBlock = 60000;
+  // A calibrated bytes-per-token changes the limit for the same memory.
+  live.restore(1.0f, 8.0f);
+  long want = affordable(60000);
+  MockServer::push(httpResponse(answerJson("ok")));
+  gemini.getAnswer("Hi");
+  assert(sentLimit() == want);
+  live.restore(1.0f, 4.0f);
+
+  // setMaxTokens() applies when smaller; streamed answers only have a limit when one is set.
+  gemini.setMaxTokens(100);
+  MockServer::push(httpResponse(answerJson("ok")));
+  gemini.getAnswer("Hi");
+  assert(sentLimit() == 100);
+  gemini.setMaxTokens(1000000);
+  MockServer::push(httpResponse(answerJson("ok")));
+  gemini.getAnswer("Hi");
+  assert(sentLimit() == affordable(60000));
+  MockServer::push(httpResponse(answerJson("ok")));
+  gemini.getAnswerStream("Hi", [](char) {});
+  assert(sentLimit() == 1000000);
+  gemini.setMaxTokens(0);
+  MockServer::push(httpResponse(answerJson("ok")));
+  gemini.getAnswerStream("Hi", [](char) {});
+  assert(sentLimit() == -1);
+
+  // Policy::maxTokens is a ceiling over everything else.
+  BasicGemini<CappedPolicy> capped;
+  capped.setApiKey("KEY");
+  capped.begin(4096);
+  MockServer::push(httpResponse(answerJson("ok")));
+  capped.getAnswerStream("Hi", [](char) {});
+  assert(sentLimit() == 50);
+  capped.setMaxTokens(1000);
+  MockServer::push(httpResponse(answerJson("ok")));
+  capped.getAnswer("Hi");
+  assert(sentLimit() == 50);
+
+  // Prompts over setMaxPromptTokens() and payloads that don't fit the payload buffer are not sent.
+  size_t sent = upstreamRequests();
+  gemini.setMaxPromptTokens(100);
+  String longQuestion(std::string(2000, 'x').c_str());
+  gemini.getAnswer(longQuestion);
+  assert(upstreamRequests() == sent && gemini.getLastUsage().promptEstimate > 100);
+  gemini.setMaxPromptTokens(0);
+  String hugeQuestion(std::string(PAYLOAD_BUFFER_SIZE + 100, 'x').c_str());
+  gemini.getAnswer(hugeQuestion);
+  assert(upstreamRequests() == sent);
+  printf("OK\n");
+}
@@ -0,0 +1,326 @@
+// GeminiLive over WebSocket.hpp against a local WebSocket server: handshake, setup, text and audio turns,
+// fragmented, large, trickled and control frames, and both ways of closing. OpenSSL checks SHA-1 and base64.
+#include "helpers.h"
+#include <Gemini_AI.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <set>
+#include <vector>
+
+static std::string base64(const std::string& data) {
+  std::string out(4 * ((data.size() + 2) / 3) + 1, '\0');
+  out.resize(EVP_EncodeBlock((unsigned char*)&out[0], (const unsigned char*)data.data(), data.size()));
+  return out;
+}
+
+static std::string unbase64(const std::string& text) {
+  std::string out(text.size(), '\0');
+  int n = EVP_DecodeBlock((unsigned char*)&out[0], (const unsigned char*)text.data(), text.size());
+  size_t padding = text.size() >= 2 && text.back() == '=' ? (text[text.size() - 2] == '=' ? 2 : 1) : 0;
+  out.resize(n - padding);
+  return out;
+}
+
+static std::string acceptFor(const std::string& key) {
+  std::string message = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  unsigned char digest[20];
+  SHA1((const unsigned char*)message.data(), message.size(), digest);
+  return base64(std::string((char*)digest, sizeof(digest)));
+}
+
+// A server frame; servers don't mask, but a masked one must be read too.
+static std::string frame(uint8_t opcode, const std::string& payload, bool fin = true, bool mask = false) {
+  std::string out(1, (char)((fin ? 0x80 : 0) | opcode));
+  uint8_t maskBit = mask ? 0x80 : 0;
+  if (payload.size() < 126) {
+    out += (char)(maskBit | payload.size());
+  } else if (payload.size() <= 0xFFFF) {
+    out += (char)(maskBit | 126);
+    out += (char)(payload.size() >> 8);
+    out += (char)payload.size();
+  } else {
+    out += (char)(maskBit | 127);
+    for (int shift = 56; shift >= 0; shift -= 8) out += (char)((uint64_t)payload.size() >> shift);
+  }
+  std::string body = payload;
+  if (mask) {
+    const char key[4] = {0x12, 0x34, 0x56, 0x78};
+    out.append(key, 4);
+    for (size_t i = 0; i < body.size(); i++) body[i] ^= key[i & 3];
+  }
+  return out + body;
+}
+
+static std::string textMessage(const std::string& text, const std::string& extra = "") {
+  return "{\"serverContent\":{\"modelTurn\":{\"parts\":[{\"text\":\"" + text + "\"}]}" + extra + "}}";
+}
+
+static std::string field(const std::string& json, const std::string& key) {
+  size_t at = json.find("\"" + key + "\":\"");
+  assert(at != std::string::npos);
+  at += key.size() + 4;
+  return json.substr(at, json.find('"', at) - at);
+}
+
+struct ClientFrame {
+  uint8_t opcode;
+  bool fin;
+  bool masked;
+  uint32_t mask;
+  std::string payload;
+};
+
+// Answers the upgrade, then parses the client's frames and hands every data frame to onMessage. A close is
+// echoed.
+struct Server {
+  bool upgraded = false;
+  bool badAccept = false;
+  std::vector<ClientFrame> frames;
+  std::string audio;
+  std::function<void(const ClientFrame&, std::string& in)> onMessage;
+
+  void operator()(std::string& out, std::string& in) {
+    if (!upgraded) {
+      size_t end = out.find("\r\n\r\n");
+      if (end == std::string::npos) return;
+      std::string request = out.substr(0, end + 4);
+      out.erase(0, end + 4);
+      assert(request.rfind("GET /ws/google.ai.generativelanguage.v1beta.GenerativeService.BidiGenerateContent?key=KEY "
+                           "HTTP/1.1\r\n", 0) == 0);
+      assert(request.find("Upgrade: websocket\r\n") != std::string::npos);
+      assert(request.find("Sec-WebSocket-Version: 13\r\n") != std::string::npos);
+      size_t at = request.find("Sec-WebSocket-Key: ");
+      assert(at != std::string::npos);
+      std::string key = request.substr(at + 19, request.find("\r\n", at) - at - 19);
+      assert(key.size() == 24 && unbase64(key).size() == 16);
+      in += "HTTP/1.1 101 Switching Protocols\r\nupgrade: WebSocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " +
+            acceptFor(badAccept ? "x" : key) + "\r\n\r\n";
+      upgraded = true;
+      return;
+    }
+    while (out.size() >= 2) {
+      uint8_t first = out[0], second = out[1];
+      size_t at = 2;
+      uint64_t length = second & 0x7F;
+      if (length == 126) {
+        if (out.size() < 4) return;
+        length = (uint8_t)out[2] << 8 | (uint8_t)out[3];
+        at = 4;
+      } else if (length == 127) {
+        if (out.size() < 10) return;
+        length = 0;
+        for (int i = 0; i < 8; i++) length = length << 8 | (uint8_t)out[2 + i];
+        at = 10;
+      }
+      bool masked = second & 0x80;
+      if (masked) at += 4;
+      if (out.size() < at + length) return;
+      ClientFrame f{(uint8_t)(first & 0x0F), (first & 0x80) != 0, masked, 0, out.substr(at, length)};
+      if (masked) {
+        memcpy(&f.mask, out.data() + at - 4, 4);
+        for (size_t i = 0; i < length; i++) f.payload[i] ^= out[at - 4 + (i & 3)];
+      }
+      out.erase(0, at + length);
+      frames.push_back(f);
+      if (f.opcode == WS_CLOSE) {
+        in += frame(WS_CLOSE, f.payload);
+      } else if (onMessage && f.opcode < WS_CLOSE) {
+        onMessage(frames.back(), in);
+      }
+    }
+  }
+};
+
+static void testBase64() {
+  for (size_t n = 0; n < 200; n++) {
+    std::string data(n, '\0');
+    for (char& c : data) c = (char)rand();
+    char encoded[300];
+    size_t length = Base64::encode((const uint8_t*)data.data(), n, encoded);
+    assert(std::string(encoded, length) == base64(data));
+    std::string back;
+    Base64Decoder<7> decoder([&](const uint8_t* p, size_t size) {
+      assert(size <= 7);
+      back.append((const char*)p, size);
+    });
+    for (size_t i = 0; i < length; i++) decoder.push(encoded[i]);
+    decoder.finish();
+    assert(back == data && decoder.decoded() == n);
+  }
+}
+
+// Every handshake uses a new random key, so a wrong SHA-1 would fail one of them.
+static void testHandshake() {
+  for (int i = 0; i < 20; i++) {
+    Server server;
+    MockServer::handler() = std::ref(server);
+    server.onMessage = [](const ClientFrame&, std::string& in) { in += frame(WS_TEXT, "{\"setupComplete\":{}}"); };
+    GeminiLive live;
+    assert(live.begin("KEY") && live.connected());
+    live.end();
+    // end() closes with 1000.
+    assert(server.frames.back().opcode == WS_CLOSE && server.frames.back().payload == std::string("\x03\xE8", 2));
+  }
+  Server server;
+  server.badAccept = true;
+  MockServer::handler() = std::ref(server);
+  GeminiLive live;
+  assert(!live.begin("KEY") && !live.connected());
+  MockServer::handler() = nullptr;
+}
+
+int main() {
+  testBase64();
+  testHandshake();
+
+  Server server;
+  MockServer::handler() = std::ref(server);
+  const std::string pingPayload = "are you there";
+  const std::string big(70000, 'z');
+  std::string audioOut;
+  for (int i = 0; i < 5000; i++) audioOut += (char)(i * 7);
+  server.onMessage = [&](const ClientFrame& f, std::string& in) {
+    assert(f.masked && f.fin && f.opcode == WS_TEXT);
+    const std::string& p = f.payload;
+    if (p.find("\"setup\"") != std::string::npos) {
+      in += frame(WS_BINARY, "{\"setupComplete\": {}}");
+    } else if (p.find("\"clientContent\"") != std::string::npos) {
+      std::string text = field(p, "text");
+      if (text == "big") {
+        // A 64-bit length, masked, then a 16-bit length.
+        in += frame(WS_TEXT, textMessage(big), true, true);
+        in += frame(WS_TEXT, textMessage(std::string(300, 'y'), ",\"turnComplete\":true"));
+        return;
+      }
+      // Fragmented over three frames, with a ping and a pong between them.
+      std::string message = textMessage("Echo: " + text);
+      in += frame(WS_BINARY, message.substr(0, 10), false);
+      in += frame(WS_PING, pingPayload);
+      in += frame(WS_CONTINUATION, message.substr(10, 20), false);
+      in += frame(WS_PONG, "x");
+      in += frame(WS_CONTINUATION, message.substr(30), true);
+      in += frame(WS_BINARY, "{\"serverContent\":{\"turnComplete\":true},\"usageMetadata\":{\"promptTokenCount\":12,"
+                             "\"responseTokenCount\":7,\"totalTokenCount\":19}}");
+    } else if (p.find("\"realtimeInput\":{\"audio\"") != std::string::npos) {
+      assert(p.find("\"mimeType\":\"audio/pcm;rate=16000\"") != std::string::npos);
+      server.audio += unbase64(field(p, "data"));
+    } else if (p.find("\"audioStreamEnd\":true") != std::string::npos) {
+      std::string message = "{\"serverContent\":{\"inputTranscription\":{\"text\":\"hello\"},\"modelTurn\":{\"parts\":"
+                            "[{\"inlineData\":{\"mimeType\":\"audio/pcm;rate=24000\",\"data\":\"" + base64(audioOut) + "\"}}]}}}";
+      in += frame(WS_TEXT, message.substr(0, 1000), false);
+      in += frame(WS_CONTINUATION, message.substr(1000, 3000), false);
+      in += frame(WS_CONTINUATION, message.substr(4000), true);
+      in += frame(WS_TEXT, "{\"serverContent\":{\"outputTranscription\":{\"text\":\"hi there\"}}}");
+      in += frame(WS_TEXT, "{\"serverContent\":{\"interrupted\":true}}");
+      in += frame(WS_TEXT, "{\"goAway\":{\"timeLeft\":\"9.5s\"}}");
+    }
+  };
+
+  GeminiLive live;
+  live.setModality(LIVE_AUDIO);
+  live.setSystemInstruction("Be \"brief\"");
+  live.enableTranscription();
+  assert(live.begin("KEY") && live.connected());
+  assert(server.frames[0].payload ==
+         "{\"setup\":{\"model\":\"models/gemini-2.0-flash-live-001\",\"generationConfig\":{\"responseModalities\":"
+         "[\"AUDIO\"]},\"systemInstruction\":{\"parts\":[{\"text\":\"Be \\\"brief\\\"\"}]},\"inputAudioTranscription\":{},"
+         "\"outputAudioTranscription\":{}}}");
+
+  // A text turn; the answer is fragmented and the ping in between is answered.
+  std::string text;
+  uint32_t promptTokens = 0, answerTokens = 0;
+  int turns = 0, partEnds = 0;
+  LiveEvents events;
+  events.onText = [&](char c) { text += c; };
+  events.onPartEnd = [&](ResponsePart) { partEnds++; };
+  events.onUsage = [&](uint32_t prompt, uint32_t answer) {
+    promptTokens = prompt;
+    answerTokens = answer;
+  };
+  events.onTurnComplete = [&] { turns++; };
+  assert(live.sendText("Hi there, über"));
+  assert(server.frames.back().payload == "{\"clientContent\":{\"turns\":[{\"role\":\"user\",\"parts\":[{\"text\":"
+                                         "\"Hi there, über\"}]}],\"turnComplete\":true}}");
+  assert(live.receiveTurn(events, 2000));
+  assert(text == "Echo: Hi there, über");
+  assert(turns == 1 && partEnds == 1 && promptTokens == 12 && answerTokens == 7);
+  bool ponged = false;
+  std::set<uint32_t> masks;
+  for (const ClientFrame& f : server.frames) {
+    if (f.opcode == WS_PONG) {
+      assert(f.payload == pingPayload && f.masked);
+      ponged = true;
+    }
+    masks.insert(f.mask);
+  }
+  assert(ponged && masks.size() > 1);
+
+  // Frames with 64-bit and 16-bit lengths.
+  text.clear();
+  assert(live.sendText("big"));
+  assert(live.receiveTurn(events, 5000));
+  assert(text == big + std::string(300, 'y'));
+
+  // Audio up, 10001 samples through the payload buffer in one message, then a single sample.
+  std::vector<int16_t> mic(10001);
+  for (size_t i = 0; i < mic.size(); i++) mic[i] = (int16_t)(i * 37 - 20000);
+  size_t before = server.frames.size();
+  assert(live.sendAudio(mic.data(), mic.size()));
+  assert(live.sendAudio(mic.data(), 1));
+  assert(server.frames.size() == before + 2);
+  assert(server.audio.size() == (mic.size() + 1) * 2 && memcmp(server.audio.data(), mic.data(), mic.size() * 2) == 0);
+
+  // Audio down, decoded in LIVE_AUDIO_CHUNK blocks, with the transcripts and the other signals.
+  std::string heard, said, audioIn;
+  int interrupted = 0;
+  uint32_t goAway = 0;
+  size_t largestChunk = 0;
+  events.onAudio = [&](const uint8_t* pcm, size_t size) {
+    audioIn.append((const char*)pcm, size);
+    largestChunk = std::max(largestChunk, size);
+  };
+  events.onInputTranscript = [&](char c) { heard += c; };
+  events.onOutputTranscript = [&](char c) { said += c; };
+  events.onInterrupted = [&] { interrupted++; };
+  events.onGoAway = [&](uint32_t ms) { goAway = ms; };
+  assert(live.endAudio());
+  assert(live.receiveTurn(events, 2000));
+  assert(audioIn == audioOut && largestChunk == LIVE_AUDIO_CHUNK);
+  assert(heard == "hello" && said == "hi there" && interrupted == 1);
+  unsigned long start = millis();
+  while (!goAway && millis() - start < 1000) {
+    live.poll(events);
+    delay(1);
+  }
+  assert(goAway == 9500);
+
+  // One byte per millisecond: frame headers arrive split across reads.
+  MockServer::bandwidth() = 1;
+  server.onMessage = [&](const ClientFrame&, std::string& in) {
+    in += frame(WS_TEXT, textMessage("slow"), false);
+    in += frame(WS_PING, "p");
+    in += frame(WS_CONTINUATION, "", true);
+    in += frame(WS_TEXT, "{\"serverContent\":{\"turnComplete\":true}}");
+  };
+  text.clear();
+  assert(live.sendText("x"));
+  assert(live.receiveTurn(events, 5000));
+  assert(text == "slow");
+  MockServer::bandwidth() = 0;
+
+  // The server closes with 1008: the close is echoed and the session ends.
+  server.onMessage = [&](const ClientFrame&, std::string& in) {
+    in += frame(WS_TEXT, textMessage("bye"));
+    in += frame(WS_CLOSE, std::string("\x03\xF0", 2) + "policy");
+  };
+  text.clear();
+  assert(live.sendText("x"));
+  assert(!live.receiveTurn(events, 2000));
+  assert(text == "bye");
+  assert(!live.connected() && live.closeCode() == 1008);
+  assert(server.frames.back().opcode == WS_CLOSE && server.frames.back().payload == std::string("\x03\xF0", 2));
+  assert(!live.sendText("x"));
+  live.end();
+  MockServer::handler() = nullptr;
+  printf("OK\n");
+}